@@ -0,0 +1,246 @@
+#include "Gemini compact.h"
+#include <unordered_set>
+
+int compactMatrixSize(std::size_t bytes) {
+    std::size_t bucket = MIN_COMPACT_SLOTS * sizeof(CompactSlot);
+    int size = 1;
+    while (static_cast<std::size_t>(size) * 2 * size * 2 * bucket <= bytes) {
+        size *= 2;
+    }
+    return size;
+}
+
+int compactSlotsPerBucket(std::size_t bytes) {
+    std::size_t n = static_cast<std::size_t>(compactMatrixSize(bytes));
+    std::size_t slots = bytes / (n * n * sizeof(CompactSlot));
+    return slots < static_cast<std::size_t>(MIN_COMPACT_SLOTS) ? MIN_COMPACT_SLOTS : static_cast<int>(slots);
+}
+
+void insertion(CompactMatrix& matrix, Edge e, int granule) {
+    std::uint16_t fs = matrix.fingerprint(e.sd.first);
+    std::uint16_t fd = matrix.fingerprint(e.sd.second);
+    CompactSlot* b = matrix.bucket(matrix.hasher.row(e.sd.first), matrix.hasher.row(e.sd.second));
+    int newest = -1; // newest slot of <s, d>
+    int oldest = 0;
+    int k = 0;
+    for (; k < matrix.slots && b[k].fs != 0; ++k) {
+        if (b[k].fs == fs && b[k].fd == fd) {
+            if (b[k].time / granule == e.time / granule) {
+                b[k].weight += e.weight;
+                return;
+            }
+            if (newest == -1 || b[k].time > b[newest].time) {
+                newest = k;
+            }
+        }
+        if (b[k].time < b[oldest].time) {
+            oldest = k;
+        }
+    }
+
+    if (k == matrix.slots) {
+        if (newest != -1) {
+            b[newest].weight += e.weight;
+            matrix.aggregated += 1;
+            return;
+        }
+        k = oldest;
+        matrix.evicted += 1;
+    }
+    b[k].fs = fs;
+    b[k].fd = fd;
+    b[k].time = e.time;
+    b[k].weight = e.weight;
+}
+
+void clearMatrix(CompactMatrix& matrix) {
+    std::fill(matrix.S.data(), matrix.S.data() + matrix.S.size(), CompactSlot());
+}
+
+// Switch the roles of the two matrices, emptying the one that becomes active
+static void switchMatrices(CompactSketch& sketch) {
+    clearMatrix(sketch.aging());
+    sketch.M0.WS = !sketch.M0.WS;
+    sketch.M1.WS = !sketch.M1.WS;
+}
+
+// Move the sketch's clock to the time of an arriving edge, as for the Gemini sketch
+static void advanceTime(CompactSketch& sketch, int now) {
+    if (!sketch.started) {
+        sketch.start = now;
+        sketch.started = true;
+    }
+
+    if (now >= sketch.start + sketch.T) {
+        if (now >= sketch.start + 2 * sketch.T) {
+            // Both periods are out of the window: drop both matrices
+            clearMatrix(sketch.active());
+            sketch.start += (now - sketch.start) / sketch.T * sketch.T - sketch.T;
+        }
+        switchMatrices(sketch);
+        sketch.start += sketch.T;
+    }
+}
+
+void insertion(CompactSketch& sketch, Edge e) {
+    advanceTime(sketch, e.time);
+    insertion(sketch.active(), e, sketch.granule);
+}
+
+void insertBatch(CompactSketch& sketch, const Edge* edges, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        insertion(sketch, edges[i]);
+    }
+}
+
+void insertBatch(CompactSketch& sketch, const std::vector<Edge>& edges) {
+    insertBatch(sketch, edges.data(), edges.size());
+}
+
+static bool slotInRange(const CompactSlot& slot, int t_b, int t_e) {
+    return slot.time >= t_b && slot.time <= t_e;
+}
+
+// Total weight and number of the in-range slots of <s, d> in one matrix
+static std::pair<long long, int> edgeWeight(const CompactMatrix& matrix, std::pair<int, int> sd, int t_b, int t_e) {
+    std::uint16_t fs = matrix.fingerprint(sd.first);
+    std::uint16_t fd = matrix.fingerprint(sd.second);
+    const CompactSlot* b = matrix.bucket(matrix.hasher.row(sd.first), matrix.hasher.row(sd.second));
+    long long weight = 0;
+    int found = 0;
+    for (int k = 0; k < matrix.slots && b[k].fs != 0; ++k) {
+        if (b[k].fs == fs && b[k].fd == fd && slotInRange(b[k], t_b, t_e)) {
+            weight += b[k].weight;
+            found += 1;
+        }
+    }
+    return std::make_pair(weight, found);
+}
+
+// Total weight and number of the in-range slots with source v in one matrix
+static std::pair<long long, int> outgoingWeight(const CompactMatrix& matrix, int v, int t_b, int t_e) {
+    std::uint16_t fs = matrix.fingerprint(v);
+    int r = matrix.hasher.row(v);
+    long long weight = 0;
+    int found = 0;
+    for (int j = 0; j < matrix.size(); ++j) {
+        const CompactSlot* b = matrix.bucket(r, j);
+        for (int k = 0; k < matrix.slots && b[k].fs != 0; ++k) {
+            if (b[k].fs == fs && slotInRange(b[k], t_b, t_e)) {
+                weight += b[k].weight;
+                found += 1;
+            }
+        }
+    }
+    return std::make_pair(weight, found);
+}
+
+// Is there an in-range slot with destination v in one matrix
+static bool hasIncoming(const CompactMatrix& matrix, int v, int t_b, int t_e) {
+    std::uint16_t fd = matrix.fingerprint(v);
+    int c = matrix.hasher.row(v);
+    for (int i = 0; i < matrix.size(); ++i) {
+        const CompactSlot* b = matrix.bucket(i, c);
+        for (int k = 0; k < matrix.slots && b[k].fs != 0; ++k) {
+            if (b[k].fd == fd && slotInRange(b[k], t_b, t_e)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool vertexQuery(const CompactSketch& sketch, int v, int t_b, int t_e) {
+    return outgoingWeight(sketch.active(), v, t_b, t_e).second > 0 ||
+           outgoingWeight(sketch.aging(), v, t_b, t_e).second > 0 || hasIncoming(sketch.active(), v, t_b, t_e) ||
+           hasIncoming(sketch.aging(), v, t_b, t_e);
+}
+
+int totalOutgoingWeight(const CompactSketch& sketch, int v, int t_b, int t_e) {
+    return static_cast<int>(outgoingWeight(sketch.active(), v, t_b, t_e).first +
+                            outgoingWeight(sketch.aging(), v, t_b, t_e).first);
+}
+
+bool checkVertexRelationship(const CompactSketch& sketch, std::pair<int, int> vertexPair, int t_b, int t_e) {
+    return edgeWeight(sketch.active(), vertexPair, t_b, t_e).second > 0 ||
+           edgeWeight(sketch.aging(), vertexPair, t_b, t_e).second > 0;
+}
+
+int subgraphQuery(const CompactSketch& sketch, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit) {
+    long long totalWeight = 0;
+    for (std::size_t i = 0; i < subgraph.size(); ++i) {
+        std::pair<long long, int> active = edgeWeight(sketch.active(), subgraph[i].sd, t_b, t_e);
+        std::pair<long long, int> aging = edgeWeight(sketch.aging(), subgraph[i].sd, t_b, t_e);
+        if (active.second + aging.second == 0 && earlyExit) {
+            return -1;
+        }
+        totalWeight += active.first + aging.first;
+    }
+    return static_cast<int>(totalWeight);
+}
+
+// A compact vertex: its row and fingerprint in one key
+static std::uint32_t compactVertex(int row, std::uint16_t fingerprint) {
+    return static_cast<std::uint32_t>(row) << 16 | fingerprint;
+}
+
+bool reachabilityQuery(const CompactSketch& sketch, std::pair<int, int> startEndPair, int t_b, int t_e) {
+    // Both matrices share one hasher, so a compact vertex is the same in each
+    const CompactMatrix& m = sketch.active();
+    const CompactMatrix* matrices[2] = {&sketch.active(), &sketch.aging()};
+    std::uint32_t target = compactVertex(m.hasher.row(startEndPair.second), m.fingerprint(startEndPair.second));
+    std::vector<std::uint32_t> frontier(1, compactVertex(m.hasher.row(startEndPair.first), m.fingerprint(startEndPair.first)));
+    std::unordered_set<std::uint32_t> visited(frontier.begin(), frontier.end());
+
+    // The in-range slots of a row are collected the first time one of its vertices is
+    // expanded, as (source fingerprint, target vertex) entries, so each row is scanned once
+    std::vector<int> rowBegin(m.size(), -1), rowEnd(m.size(), -1);
+    std::vector<std::pair<std::uint16_t, std::uint32_t>> entries;
+    while (!frontier.empty()) {
+        std::uint32_t u = frontier.back();
+        frontier.pop_back();
+        int r = static_cast<int>(u >> 16);
+        std::uint16_t fs = static_cast<std::uint16_t>(u & 0xFFFF);
+        if (rowBegin[r] == -1) {
+            rowBegin[r] = static_cast<int>(entries.size());
+            for (int x = 0; x < 2; ++x) {
+                for (int j = 0; j < m.size(); ++j) {
+                    const CompactSlot* b = matrices[x]->bucket(r, j);
+                    for (int k = 0; k < m.slots && b[k].fs != 0; ++k) {
+                        if (slotInRange(b[k], t_b, t_e)) {
+                            entries.push_back(std::make_pair(b[k].fs, compactVertex(j, b[k].fd)));
+                        }
+                    }
+                }
+            }
+            rowEnd[r] = static_cast<int>(entries.size());
+        }
+        for (int e = rowBegin[r]; e < rowEnd[r]; ++e) {
+            if (entries[e].first != fs) {
+                continue;
+            }
+            std::uint32_t w = entries[e].second;
+            if (w == target) {
+                return true;
+            }
+            if (visited.insert(w).second) {
+                frontier.push_back(w);
+            }
+        }
+    }
+    return false;
+}
+
+MemoryStats memoryStats(const CompactSketch& sketch) {
+    MemoryStats stats;
+    stats.reservedBytes = sizeof(sketch) + reservedBytes(sketch.M0.S.data()) + reservedBytes(sketch.M1.S.data());
+    stats.liveBytes = sizeof(sketch);
+    stats.allocations = 2;
+    const CompactMatrix* matrices[2] = {&sketch.M0, &sketch.M1};
+    for (int x = 0; x < 2; ++x) {
+        for (std::size_t k = 0; k < matrices[x]->S.size(); ++k) {
+            stats.liveBytes += matrices[x]->S[k].fs != 0 ? sizeof(CompactSlot) : 0;
+        }
+    }
+    return stats;
+}
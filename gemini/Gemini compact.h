@@ -0,0 +1,99 @@
+#ifndef GEMINI_COMPACT_H
+#define GEMINI_COMPACT_H
+
+#include "GeminiSketch_Algorithm.h"
+#include <cstdint>
+
+// Fewest slots per bucket a compact matrix is laid out with
+const int MIN_COMPACT_SLOTS = 4;
+
+// One <s, d> within one time granule: the edges are aggregated into a weight counter,
+// stamped with the time of the first of them. Vertices are kept as 16-bit fingerprints.
+struct CompactSlot {
+    std::uint16_t fs; // fingerprint of s (0 = free slot)
+    std::uint16_t fd; // fingerprint of d
+    int time; // time of the first edge of the slot
+    int weight; // total weight of the slot's edges
+    CompactSlot() : fs(0), fd(0), time(0), weight(0) {}
+};
+
+// Fixed-capacity working matrix: n x n buckets of `slots` compact slots, held in one
+// block allocated up front. Sources and destinations are both placed with the row hash,
+// so the column of a destination is also the row of its outgoing edges; the column
+// hash supplies the fingerprints. A bucket's slots fill from the front and are only
+// freed all at once, when the matrix is cleared.
+struct CompactMatrix {
+    int n; // matrix dimension (a power of two)
+    int slots; // slots per bucket
+    Hasher hasher;
+    AlignedArray<CompactSlot> S; // bucket (i, j) is S[(i * n + j) * slots, ... + slots)
+    int WS; // working status
+    long long aggregated; // edges folded into an older slot of their <s, d> because the bucket was full
+    long long evicted; // slots overwritten, oldest first, to make room for a new <s, d>
+    CompactMatrix(int size, int slotsPerBucket, unsigned seed = 0)
+        : n(nextPowerOfTwo(size)), slots(slotsPerBucket), hasher(n, seed),
+          S(static_cast<std::size_t>(n) * n * slotsPerBucket), WS(0), aggregated(0), evicted(0) {}
+
+    int size() const { return n; }
+    CompactSlot* bucket(int i, int j) { return &S[(static_cast<std::size_t>(i) * n + j) * slots]; }
+    const CompactSlot* bucket(int i, int j) const { return &S[(static_cast<std::size_t>(i) * n + j) * slots]; }
+    // Fingerprint of v, never 0
+    std::uint16_t fingerprint(int v) const {
+        std::uint16_t f = static_cast<std::uint16_t>(XXH32(&v, sizeof(v), hasher.colSeed) >> 16);
+        return f == 0 ? 1 : f;
+    }
+};
+
+// Largest matrix dimension with MIN_COMPACT_SLOTS slots per bucket in the given bytes,
+// and the slots per bucket that dimension leaves room for
+int compactMatrixSize(std::size_t bytes);
+int compactSlotsPerBucket(std::size_t bytes);
+
+// Gemini sketch with a hard memory budget: two compact matrices that take turns as in
+// GeminiSketch, each laid out from half of the budget when the sketch is built.
+// Nothing is allocated afterwards, so the footprint does not depend on the stream.
+// Edges of one <s, d> whose times fall in the same granule (time / granule) share a
+// slot. When every slot of a bucket is taken, an edge whose <s, d> already has a slot
+// is added to its newest one; otherwise the bucket's oldest slot is overwritten.
+struct CompactSketch {
+    CompactMatrix M0;
+    CompactMatrix M1;
+    int T; // period length (expiration threshold)
+    int granule; // time granule of a slot
+    int start; // first timestamp of the active period
+    bool started; // false until the first edge sets start
+    CompactSketch(std::size_t budgetBytes, int T, int granule, unsigned seed = 0)
+        : M0(compactMatrixSize(budgetBytes / 2), compactSlotsPerBucket(budgetBytes / 2), seed),
+          M1(compactMatrixSize(budgetBytes / 2), compactSlotsPerBucket(budgetBytes / 2), seed), T(T), granule(granule),
+          start(0), started(false) {
+        M0.WS = 1;
+    }
+
+    CompactMatrix& active() { return M0.WS ? M0 : M1; }
+    const CompactMatrix& active() const { return M0.WS ? M0 : M1; }
+    CompactMatrix& aging() { return M0.WS ? M1 : M0; }
+    const CompactMatrix& aging() const { return M0.WS ? M1 : M0; }
+};
+
+void insertion(CompactMatrix& matrix, Edge e, int granule);
+void clearMatrix(CompactMatrix& matrix);
+
+// Same period handling as the Gemini sketch: an edge of the next period clears the
+// aging matrix and makes it the active one
+void insertion(CompactSketch& sketch, Edge e);
+void insertBatch(CompactSketch& sketch, const Edge* edges, std::size_t count);
+void insertBatch(CompactSketch& sketch, const std::vector<Edge>& edges);
+
+// Queries merge both matrices; a slot is in [t_b, t_e] if its time is, so a range
+// boundary is only resolved to a granule. Fingerprint collisions add to the answers.
+bool vertexQuery(const CompactSketch& sketch, int v, int t_b, int t_e);
+int totalOutgoingWeight(const CompactSketch& sketch, int v, int t_b, int t_e);
+bool checkVertexRelationship(const CompactSketch& sketch, std::pair<int, int> vertexPair, int t_b, int t_e);
+int subgraphQuery(const CompactSketch& sketch, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit = true);
+// Search over (row, fingerprint) vertices, which is what a compact matrix can follow
+bool reachabilityQuery(const CompactSketch& sketch, std::pair<int, int> startEndPair, int t_b, int t_e);
+
+// Slots held (live) out of the preallocated ones (reserved)
+MemoryStats memoryStats(const CompactSketch& sketch);
+
+#endif
@@ -0,0 +1,264 @@
+#include "Gemini concurrent.h"
+#include <algorithm>
+#include <chrono>
+
+ConcurrentSketch::ConcurrentSketch(int size, int T, int maxReaders, unsigned seed, int chainLength, int publishEvery,
+                                   int maxSnapshots)
+    : live(size, T, seed, chainLength), size(size), T(T), chainLength(chainLength), seed(seed), edges(0),
+      publishEvery(publishEvery), maxSnapshots(std::max(maxSnapshots, 2)), snapshots(1), nextPublish(publishEvery),
+      current(new Snapshot(size, T, seed, chainLength)), epoch(1), readers(static_cast<std::size_t>(maxReaders)),
+      generation(1), dirtyIn(2 * live.M0.cells(), 0), trimmedTo(0) {
+    clearedIn[0] = 0;
+    clearedIn[1] = 0;
+}
+
+ConcurrentSketch::~ConcurrentSketch() {
+    // No reader may outlive the sketch
+    delete current.load();
+    for (std::size_t i = 0; i < retired.size(); ++i) {
+        delete retired[i].first;
+    }
+    for (std::size_t i = 0; i < pool.size(); ++i) {
+        delete pool[i];
+    }
+}
+
+// Move every retired snapshot that no active reader can still hold to the pool
+static void reclaim(ConcurrentSketch& sketch) {
+    unsigned long long oldest = ULLONG_MAX;
+    for (std::size_t i = 0; i < sketch.readers.size(); ++i) {
+        unsigned long long entered = sketch.readers[i].epoch.load(std::memory_order_seq_cst);
+        if (entered != 0 && entered < oldest) {
+            oldest = entered;
+        }
+    }
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < sketch.retired.size(); ++i) {
+        if (sketch.retired[i].second <= oldest) {
+            sketch.pool.push_back(sketch.retired[i].first);
+        } else {
+            sketch.retired[kept++] = sketch.retired[i];
+        }
+    }
+    sketch.retired.resize(kept);
+}
+
+static WorkingMatrix& matrixOf(GeminiSketch& sketch, int m) {
+    return m == 0 ? sketch.M0 : sketch.M1;
+}
+
+// Record that bucket k of matrix m changed in the current generation
+static void markDirty(ConcurrentSketch& sketch, int m, int k) {
+    std::size_t cell = static_cast<std::size_t>(m) * sketch.live.M0.cells() + static_cast<std::size_t>(k);
+    if (sketch.dirtyIn[cell] != sketch.generation) {
+        sketch.dirtyIn[cell] = sketch.generation;
+        sketch.dirtyLog.push_back(ConcurrentSketch::DirtyCell(sketch.generation, cell));
+    }
+}
+
+// Everything of a matrix but its buckets
+static void copyMatrixHeader(const WorkingMatrix& from, WorkingMatrix& to) {
+    to.hasher = from.hasher;
+    to.g = from.g;
+    to.overflow = from.overflow;
+    to.WS = from.WS;
+    to.HP = from.HP;
+    to.MP = from.MP;
+    to.TP = from.TP;
+}
+
+// Reset every occupied bucket of a snapshot's matrix
+// A sequential sweep, rather than clearMatrix's walk of the bucket queue, which
+// visits the buckets in the order they were claimed and misses the cache on each.
+static void resetMatrix(WorkingMatrix& matrix) {
+    for (std::size_t k = 0; k < matrix.cells(); ++k) {
+        if (matrix.G[k].CF != 0) {
+            matrix.G[k] = Bucket();
+            matrix.list(k).clear();
+        }
+    }
+    matrix.HP = -1;
+    matrix.MP = -1;
+    matrix.TP = -1;
+}
+
+// Hint the cache that bucket k of the matrix and its edge ring are about to be copied
+static inline void prefetchCell(const WorkingMatrix& matrix, std::size_t k) {
+#if defined(__GNUC__)
+    __builtin_prefetch(&matrix.G[k]);
+#endif
+    prefetchRing(matrix, k);
+}
+
+// Bring the snapshot from its synced generation up to live
+// It matched live as of that generation, so resetting a matrix live cleared since
+// resets every bucket live's clear reset; buckets changed since are copied after.
+// Each cell is copied once, at the log entry of the last generation it changed in.
+// Cells go QUERY_PREFETCH_BLOCK at a time: both sides' buckets and rings are
+// prefetched, then the ring columns, then the block is copied. Returns the number of
+// buckets copied.
+static long long syncSnapshot(ConcurrentSketch& sketch, ConcurrentSketch::Snapshot& snapshot) {
+    GeminiSketch& to = snapshot.sketch;
+    for (int m = 0; m < 2; ++m) {
+        if (sketch.clearedIn[m] > snapshot.synced) {
+            resetMatrix(matrixOf(to, m));
+        }
+    }
+
+    std::size_t cells = sketch.live.M0.cells();
+    std::vector<ConcurrentSketch::DirtyCell>::const_iterator it = std::upper_bound(
+        sketch.dirtyLog.begin(), sketch.dirtyLog.end(), snapshot.synced,
+        [](unsigned long long synced, const ConcurrentSketch::DirtyCell& dirty) { return synced < dirty.generation; });
+    std::size_t block[QUERY_PREFETCH_BLOCK];
+    long long copied = 0;
+    while (it != sketch.dirtyLog.end()) {
+        std::size_t count = 0;
+        for (; it != sketch.dirtyLog.end() && count < QUERY_PREFETCH_BLOCK; ++it) {
+            if (sketch.dirtyIn[it->cell] == it->generation) {
+                block[count++] = it->cell;
+                prefetchCell(matrixOf(sketch.live, static_cast<int>(it->cell / cells)), it->cell % cells);
+                prefetchCell(matrixOf(to, static_cast<int>(it->cell / cells)), it->cell % cells);
+            }
+        }
+        for (std::size_t b = 0; b < count; ++b) {
+            prefetchColumns(matrixOf(sketch.live, static_cast<int>(block[b] / cells)), block[b] % cells);
+            prefetchColumns(matrixOf(to, static_cast<int>(block[b] / cells)), block[b] % cells);
+        }
+        for (std::size_t b = 0; b < count; ++b) {
+            const WorkingMatrix& from = matrixOf(sketch.live, static_cast<int>(block[b] / cells));
+            WorkingMatrix& into = matrixOf(to, static_cast<int>(block[b] / cells));
+            std::size_t k = block[b] % cells;
+            into.G[k] = from.G[k];
+            into.list(k).assign(from.list(k));
+        }
+        copied += static_cast<long long>(count);
+    }
+
+    copyMatrixHeader(sketch.live.M0, to.M0);
+    copyMatrixHeader(sketch.live.M1, to.M1);
+    to.T = sketch.live.T;
+    to.start = sketch.live.start;
+    to.started = sketch.live.started;
+    return copied;
+}
+
+// Drop the log entries every remaining snapshot already holds
+static void trimDirtyLog(ConcurrentSketch& sketch) {
+    unsigned long long oldest = sketch.current.load(std::memory_order_relaxed)->synced;
+    for (std::size_t i = 0; i < sketch.retired.size(); ++i) {
+        oldest = std::min(oldest, sketch.retired[i].first->synced);
+    }
+    for (std::size_t i = 0; i < sketch.pool.size(); ++i) {
+        oldest = std::min(oldest, sketch.pool[i]->synced);
+    }
+    std::vector<ConcurrentSketch::DirtyCell>::iterator end = std::upper_bound(
+        sketch.dirtyLog.begin(), sketch.dirtyLog.end(), oldest,
+        [](unsigned long long synced, const ConcurrentSketch::DirtyCell& dirty) { return synced < dirty.generation; });
+    sketch.dirtyLog.erase(sketch.dirtyLog.begin(), end);
+    sketch.trimmedTo = std::max(sketch.trimmedTo, oldest);
+}
+
+bool publish(ConcurrentSketch& sketch) {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    reclaim(sketch);
+    ConcurrentSketch::Snapshot* next;
+    long long copied;
+    if (sketch.pool.empty()) {
+        if (sketch.snapshots >= sketch.maxSnapshots) {
+            sketch.publishStats.deferred += 1;
+            return false;
+        }
+        // A new snapshot is live as of generation 0: it catches up from the log while
+        // the log still goes back that far, and is copied whole after that
+        next = new ConcurrentSketch::Snapshot(sketch.size, sketch.T, sketch.seed, sketch.chainLength);
+        sketch.snapshots += 1;
+        if (sketch.trimmedTo == 0) {
+            copied = syncSnapshot(sketch, *next);
+        } else {
+            copySketch(sketch.live, next->sketch);
+            copied = static_cast<long long>(2 * sketch.live.M0.cells());
+        }
+    } else {
+        // The most recently synced snapshot has the fewest changes to catch up on
+        std::size_t best = 0;
+        for (std::size_t i = 1; i < sketch.pool.size(); ++i) {
+            if (sketch.pool[i]->synced > sketch.pool[best]->synced) {
+                best = i;
+            }
+        }
+        next = sketch.pool[best];
+        sketch.pool[best] = sketch.pool.back();
+        sketch.pool.pop_back();
+        copied = syncSnapshot(sketch, *next);
+    }
+    next->edges = sketch.edges;
+    next->synced = sketch.generation;
+    sketch.generation += 1;
+
+    // A reader that enters in the new epoch loads `current` after this exchange, so
+    // only readers that entered before it can still hold the old snapshot
+    ConcurrentSketch::Snapshot* old = sketch.current.exchange(next, std::memory_order_seq_cst);
+    unsigned long long retiredIn = sketch.epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    sketch.retired.push_back(std::make_pair(old, retiredIn));
+    trimDirtyLog(sketch);
+
+    long long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    sketch.publishStats.publishes += 1;
+    sketch.publishStats.nanos += nanos;
+    sketch.publishStats.maxNanos = std::max(sketch.publishStats.maxNanos, nanos);
+    sketch.publishStats.bucketsCopied += copied;
+    return true;
+}
+
+// Insert into the live sketch, recording what changed: the matrices a period switch
+// cleared, the bucket that took the edge and, when the edge claimed a new bucket,
+// the old queue tail it was linked after
+void insertion(ConcurrentSketch& sketch, Edge e) {
+    GeminiSketch& live = sketch.live;
+    bool started = live.started;
+    int start = live.start;
+    int tails[2] = {live.M0.TP, live.M1.TP};
+    int k = insertion(live, e);
+
+    int m = live.M0.WS ? 0 : 1;
+    if (started && live.start != start) {
+        // One period: the old aging matrix, now active, was cleared; more: both were
+        sketch.clearedIn[m] = sketch.generation;
+        tails[m] = -1;
+        if (live.start - start > live.T) {
+            sketch.clearedIn[1 - m] = sketch.generation;
+        }
+    }
+
+    if (k != -1) {
+        markDirty(sketch, m, k);
+        if (matrixOf(live, m).TP != tails[m] && tails[m] != -1) {
+            markDirty(sketch, m, tails[m]);
+        }
+    }
+    sketch.edges += 1;
+    if (sketch.edges >= sketch.nextPublish) {
+        bool published = publish(sketch);
+        sketch.nextPublish = sketch.edges + (published ? sketch.publishEvery : std::max(sketch.publishEvery / 8, 1));
+    }
+}
+
+void insertBatch(ConcurrentSketch& sketch, const Edge* edges, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        insertion(sketch, edges[i]);
+    }
+}
+
+void insertBatch(ConcurrentSketch& sketch, const std::vector<Edge>& edges) {
+    insertBatch(sketch, edges.data(), edges.size());
+}
+
+SnapshotGuard::SnapshotGuard(const ConcurrentSketch& sketch, int id) : slot_(sketch.readers[id]) {
+    slot_.epoch.store(sketch.epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    snapshot_ = sketch.current.load(std::memory_order_seq_cst);
+}
+
+SnapshotGuard::~SnapshotGuard() {
+    slot_.epoch.store(0, std::memory_order_release);
+}
@@ -0,0 +1,120 @@
+#ifndef GEMINI_CONCURRENT_H
+#define GEMINI_CONCURRENT_H
+
+#include "GeminiSketch_Algorithm.h"
+#include <atomic>
+
+// Gemini sketch with lock-free readers during ingestion
+// One writer thread inserts (and so expires) into `live`. Every `publishEvery` edges
+// it brings an unused snapshot up to date with live and publishes it with one atomic
+// store. Readers run the ordinary GeminiSketch queries on the current snapshot without
+// taking a lock. Snapshots replaced by a newer one are retired and reclaimed with
+// epochs: each reader announces the global epoch it entered in, and a retired
+// snapshot is reused once every active reader entered after it was retired.
+//
+// Publishing is incremental. The writer stamps every bucket it changes with the
+// current generation (one generation per publish interval) and logs it, and notes the
+// generation in which each matrix was cleared by a switch. A reused snapshot records
+// the generation it was last synced to, so bringing it up to date clears its matrices
+// if live's were cleared since, then copies only the buckets (metadata and edge ring)
+// logged after that generation. A snapshot built once the log no longer reaches back
+// to the empty sketch is copied whole.
+// At most maxSnapshots snapshots exist: when all of them are still pinned by readers,
+// the publish is put off and retried publishEvery / 8 edges later.
+struct ConcurrentSketch {
+    struct Snapshot {
+        GeminiSketch sketch;
+        long long edges; // edges ingested when it was taken
+        unsigned long long synced; // last generation whose changes it holds
+        Snapshot(int size, int T, unsigned seed, int chainLength)
+            : sketch(size, T, seed, chainLength), edges(0), synced(0) {}
+    };
+
+    // Bucket changed in a generation; cell is matrix * cells + bucket index
+    struct DirtyCell {
+        unsigned long long generation;
+        std::size_t cell;
+        DirtyCell(unsigned long long generation, std::size_t cell) : generation(generation), cell(cell) {}
+    };
+
+    // Writer-side cost of publishing, so the pauses show apart from the insert rate
+    struct PublishStats {
+        long long publishes;
+        long long nanos; // total time spent publishing
+        long long maxNanos; // longest single publish
+        long long bucketsCopied;
+        long long deferred; // publishes put off because every snapshot was pinned
+        PublishStats() : publishes(0), nanos(0), maxNanos(0), bucketsCopied(0), deferred(0) {}
+    };
+
+    // One per reader, on its own cache line: 0 while idle, else the entry epoch
+    struct ReaderSlot {
+        std::atomic<unsigned long long> epoch;
+        char pad[CACHE_LINE_SIZE - sizeof(std::atomic<unsigned long long>)];
+        ReaderSlot() : epoch(0) {}
+    };
+
+    GeminiSketch live; // writer only
+    int size, T, chainLength;
+    unsigned seed;
+    long long edges; // edges ingested so far
+    int publishEvery; // edges between snapshots
+    int maxSnapshots; // snapshots alive at most: current, retired and pooled
+    int snapshots; // snapshots alive
+    long long nextPublish; // edge count at which the writer next tries to publish
+
+    std::atomic<Snapshot*> current;
+    std::atomic<unsigned long long> epoch; // starts at 1, so 0 can mean idle
+    mutable AlignedArray<ReaderSlot> readers; // written by readers holding a const sketch
+
+    // Writer-side reclamation state
+    std::vector<std::pair<Snapshot*, unsigned long long> > retired; // snapshot, epoch it was retired in
+    std::vector<Snapshot*> pool; // reclaimed snapshots, reused by the next publish
+
+    // Writer-side change tracking
+    unsigned long long generation; // generation receiving changes, one past the last published
+    std::vector<unsigned long long> dirtyIn; // per cell: last generation it changed in (0 = never)
+    std::vector<DirtyCell> dirtyLog; // changed cells in generation order, back to the oldest snapshot
+    unsigned long long trimmedTo; // generations up to this one are no longer logged
+    unsigned long long clearedIn[2]; // per matrix: last generation a switch cleared it in
+    PublishStats publishStats;
+
+    ConcurrentSketch(int size, int T, int maxReaders, unsigned seed = 0, int chainLength = 1, int publishEvery = 1 << 12,
+                     int maxSnapshots = 3);
+    ~ConcurrentSketch();
+
+private:
+    ConcurrentSketch(const ConcurrentSketch&);
+    ConcurrentSketch& operator=(const ConcurrentSketch&);
+};
+
+// Writer: insert e into the live sketch, publishing a snapshot every publishEvery edges
+// (retried sooner when the last attempt found every snapshot pinned)
+void insertion(ConcurrentSketch& sketch, Edge e);
+void insertBatch(ConcurrentSketch& sketch, const Edge* edges, std::size_t count);
+void insertBatch(ConcurrentSketch& sketch, const std::vector<Edge>& edges);
+
+// Writer: reclaim the snapshots no reader can see and publish the live sketch now
+// Only the buckets changed since the reused snapshot's last sync are copied. Returns
+// false, publishing nothing, if maxSnapshots exist and readers still pin all of them.
+bool publish(ConcurrentSketch& sketch);
+
+// Reader `id` (0 <= id < maxReaders) pins the current snapshot for its lifetime
+// Queries take guard.sketch() like any GeminiSketch; it stays valid until the guard ends.
+class SnapshotGuard {
+public:
+    SnapshotGuard(const ConcurrentSketch& sketch, int id);
+    ~SnapshotGuard();
+
+    const GeminiSketch& sketch() const { return snapshot_->sketch; }
+    long long edges() const { return snapshot_->edges; }
+
+private:
+    SnapshotGuard(const SnapshotGuard&);
+    SnapshotGuard& operator=(const SnapshotGuard&);
+
+    ConcurrentSketch::ReaderSlot& slot_;
+    const ConcurrentSketch::Snapshot* snapshot_;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "Gemini exact.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
+// Bucket the log positions by vertex (src or dst) into a CSR list; positions are
+// visited in log order, so every list comes out in time order
+static void buildVertexIndex(const ExactGraph& graph, const std::vector<int>& endpoint,
+                             std::vector<std::uint32_t>& start, std::vector<std::uint32_t>& pos) {
+    std::size_t n = graph.vertices.size();
+    std::vector<int> ids(endpoint.size());
+    start.assign(n + 1, 0);
+    for (std::size_t k = 0; k < endpoint.size(); ++k) {
+        ids[k] = graph.vertexId(endpoint[k]);
+        start[ids[k] + 1] += 1;
+    }
+    for (std::size_t v = 0; v < n; ++v) {
+        start[v + 1] += start[v];
+    }
+    pos.resize(endpoint.size());
+    std::vector<std::uint32_t> next(start.begin(), start.end() - 1);
+    for (std::size_t k = 0; k < endpoint.size(); ++k) {
+        pos[next[ids[k]]++] = static_cast<std::uint32_t>(k);
+    }
+}
+
+// Edges held as columns, indexed like a vector<Edge>
+struct EdgeColumns {
+    const std::int32_t* source;
+    const std::int32_t* target;
+    const std::int32_t* weight;
+    const std::int32_t* time;
+    std::size_t count;
+
+    std::size_t size() const { return count; }
+    Edge operator[](std::size_t i) const { return Edge(std::make_pair(source[i], target[i]), weight[i], time[i]); }
+};
+
+// Build the log and the indexes from any indexable edge list
+template <typename Edges>
+static void buildGraph(ExactGraph& graph, const Edges& edges) {
+    // Time-sorted log; edges with the same time keep the stream order
+    std::vector<std::uint32_t> order(edges.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return edges[a].time < edges[b].time;
+    });
+    graph.src.reserve(edges.size());
+    graph.dst.reserve(edges.size());
+    graph.weight.reserve(edges.size());
+    graph.time.reserve(edges.size());
+    for (std::size_t k = 0; k < order.size(); ++k) {
+        Edge e = edges[order[k]];
+        graph.src.push_back(e.sd.first);
+        graph.dst.push_back(e.sd.second);
+        graph.weight.push_back(e.weight);
+        graph.time.push_back(e.time);
+    }
+    std::vector<std::uint32_t>().swap(order);
+
+    graph.vertices.reserve(2 * edges.size());
+    graph.vertices.insert(graph.vertices.end(), graph.src.begin(), graph.src.end());
+    graph.vertices.insert(graph.vertices.end(), graph.dst.begin(), graph.dst.end());
+    std::sort(graph.vertices.begin(), graph.vertices.end());
+    graph.vertices.erase(std::unique(graph.vertices.begin(), graph.vertices.end()), graph.vertices.end());
+    graph.vertices.shrink_to_fit();
+
+    buildVertexIndex(graph, graph.src, graph.outStart, graph.outPos);
+    buildVertexIndex(graph, graph.dst, graph.inStart, graph.inPos);
+
+    graph.outPrefix.resize(graph.outPos.size() + 1);
+    graph.outPrefix[0] = 0;
+    for (std::size_t k = 0; k < graph.outPos.size(); ++k) {
+        graph.outPrefix[k + 1] = graph.outPrefix[k] + graph.weight[graph.outPos[k]];
+    }
+
+    graph.pairPos = graph.outPos;
+    for (std::size_t v = 0; v + 1 < graph.outStart.size(); ++v) {
+        std::stable_sort(graph.pairPos.begin() + graph.outStart[v], graph.pairPos.begin() + graph.outStart[v + 1],
+                         [&](std::uint32_t a, std::uint32_t b) { return graph.dst[a] < graph.dst[b]; });
+    }
+}
+
+ExactGraph::ExactGraph(const std::vector<Edge>& edges) {
+    buildGraph(*this, edges);
+}
+
+ExactGraph::ExactGraph(const std::int32_t* source, const std::int32_t* target, const std::int32_t* weight,
+                       const std::int32_t* time, std::size_t count) {
+    EdgeColumns edges = {source, target, weight, time, count};
+    buildGraph(*this, edges);
+}
+
+int ExactGraph::vertexId(int v) const {
+    std::vector<int>::const_iterator it = std::lower_bound(vertices.begin(), vertices.end(), v);
+    return it != vertices.end() && *it == v ? static_cast<int>(it - vertices.begin()) : -1;
+}
+
+std::size_t ExactGraph::memoryBytes() const {
+    return (src.capacity() + dst.capacity() + weight.capacity() + time.capacity() + vertices.capacity()) * sizeof(int) +
+           (outStart.capacity() + outPos.capacity() + inStart.capacity() + inPos.capacity() + pairPos.capacity()) *
+               sizeof(std::uint32_t) +
+           outPrefix.capacity() * sizeof(long long);
+}
+
+// Narrow a time-ordered list of positions to the ones within [t_b, t_e]
+static std::pair<const std::uint32_t*, const std::uint32_t*> inRange(const ExactGraph& graph, const std::uint32_t* first,
+                                                                   const std::uint32_t* last, int t_b, int t_e) {
+    const std::uint32_t* lo = std::lower_bound(first, last, t_b, [&](std::uint32_t k, int t) { return graph.time[k] < t; });
+    const std::uint32_t* hi = std::upper_bound(lo, last, t_e, [&](int t, std::uint32_t k) { return t < graph.time[k]; });
+    return std::make_pair(lo, hi);
+}
+
+// Positions of the <s, d> edges, in time order
+static std::pair<const std::uint32_t*, const std::uint32_t*> pairList(const ExactGraph& graph, std::pair<int, int> sd) {
+    int s = graph.vertexId(sd.first);
+    if (s == -1) {
+        return std::make_pair(nullptr, nullptr);
+    }
+    const std::uint32_t* first = graph.pairPos.data() + graph.outStart[s];
+    const std::uint32_t* last = graph.pairPos.data() + graph.outStart[s + 1];
+    const std::uint32_t* lo = std::lower_bound(first, last, sd.second, [&](std::uint32_t k, int d) { return graph.dst[k] < d; });
+    const std::uint32_t* hi = std::upper_bound(lo, last, sd.second, [&](int d, std::uint32_t k) { return d < graph.dst[k]; });
+    return std::make_pair(lo, hi);
+}
+
+bool vertexQuery(const ExactGraph& graph, int v, int t_b, int t_e) {
+    int id = graph.vertexId(v);
+    if (id == -1) {
+        return false;
+    }
+    std::pair<const std::uint32_t*, const std::uint32_t*> out =
+        inRange(graph, graph.outPos.data() + graph.outStart[id], graph.outPos.data() + graph.outStart[id + 1], t_b, t_e);
+    if (out.first != out.second) {
+        return true;
+    }
+    std::pair<const std::uint32_t*, const std::uint32_t*> in =
+        inRange(graph, graph.inPos.data() + graph.inStart[id], graph.inPos.data() + graph.inStart[id + 1], t_b, t_e);
+    return in.first != in.second;
+}
+
+long long totalOutgoingWeight(const ExactGraph& graph, int v, int t_b, int t_e) {
+    int id = graph.vertexId(v);
+    if (id == -1) {
+        return 0;
+    }
+    std::pair<const std::uint32_t*, const std::uint32_t*> out =
+        inRange(graph, graph.outPos.data() + graph.outStart[id], graph.outPos.data() + graph.outStart[id + 1], t_b, t_e);
+    return graph.outPrefix[out.second - graph.outPos.data()] - graph.outPrefix[out.first - graph.outPos.data()];
+}
+
+int outgoingEdgeCount(const ExactGraph& graph, int v, int t_b, int t_e) {
+    int id = graph.vertexId(v);
+    if (id == -1) {
+        return 0;
+    }
+    std::pair<const std::uint32_t*, const std::uint32_t*> out =
+        inRange(graph, graph.outPos.data() + graph.outStart[id], graph.outPos.data() + graph.outStart[id + 1], t_b, t_e);
+    return static_cast<int>(out.second - out.first);
+}
+
+bool checkVertexRelationship(const ExactGraph& graph, std::pair<int, int> vertexPair, int t_b, int t_e) {
+    std::pair<const std::uint32_t*, const std::uint32_t*> list = pairList(graph, vertexPair);
+    std::pair<const std::uint32_t*, const std::uint32_t*> range = inRange(graph, list.first, list.second, t_b, t_e);
+    return range.first != range.second;
+}
+
+long long subgraphQuery(const ExactGraph& graph, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit) {
+    long long totalWeight = 0;
+    for (std::size_t i = 0; i < subgraph.size(); ++i) {
+        std::pair<const std::uint32_t*, const std::uint32_t*> list = pairList(graph, subgraph[i].sd);
+        std::pair<const std::uint32_t*, const std::uint32_t*> range = inRange(graph, list.first, list.second, t_b, t_e);
+        if (range.first == range.second && earlyExit) {
+            return -1;
+        }
+        for (const std::uint32_t* k = range.first; k != range.second; ++k) {
+            totalWeight += graph.weight[*k];
+        }
+    }
+    return totalWeight;
+}
+
+// Expand one frontier by a level over the in-range edges of the CSR (start, pos).
+// Returns true as soon as an edge reaches a vertex of `other`, the opposite search's
+// visited set.
+static bool expandLevel(const ExactGraph& graph, const std::vector<std::uint32_t>& start, const std::vector<std::uint32_t>& pos,
+                        const std::vector<int>& endpoint, int t_b, int t_e, std::vector<int>& frontier,
+                        std::unordered_set<int>& visited, const std::unordered_set<int>& other) {
+    std::vector<int> next;
+    for (std::size_t f = 0; f < frontier.size(); ++f) {
+        int v = frontier[f];
+        std::pair<const std::uint32_t*, const std::uint32_t*> range =
+            inRange(graph, pos.data() + start[v], pos.data() + start[v + 1], t_b, t_e);
+        for (const std::uint32_t* k = range.first; k != range.second; ++k) {
+            int w = graph.vertexId(endpoint[*k]);
+            if (other.count(w) != 0) {
+                return true;
+            }
+            if (visited.insert(w).second) {
+                next.push_back(w);
+            }
+        }
+    }
+    frontier.swap(next);
+    return false;
+}
+
+bool reachabilityQuery(const ExactGraph& graph, std::pair<int, int> startEndPair, int t_b, int t_e) {
+    int s = graph.vertexId(startEndPair.first);
+    int d = graph.vertexId(startEndPair.second);
+    if (s == -1 || d == -1) {
+        return false;
+    }
+
+    // forward holds vertices reachable from s, backward those that reach d; an edge from
+    // the first set into the second closes a path of at least one edge
+    std::unordered_set<int> forward, backward;
+    std::vector<int> forwardFrontier(1, s), backwardFrontier(1, d);
+    forward.insert(s);
+    backward.insert(d);
+    while (!forwardFrontier.empty() && !backwardFrontier.empty()) {
+        bool met = forwardFrontier.size() <= backwardFrontier.size()
+                       ? expandLevel(graph, graph.outStart, graph.outPos, graph.dst, t_b, t_e, forwardFrontier, forward, backward)
+                       : expandLevel(graph, graph.inStart, graph.inPos, graph.src, t_b, t_e, backwardFrontier, backward, forward);
+        if (met) {
+            return true;
+        }
+    }
+    return false;
+}
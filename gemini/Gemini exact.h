@@ -0,0 +1,55 @@
+#ifndef GEMINI_EXACT_H
+#define GEMINI_EXACT_H
+
+#include "GeminiSketch_Algorithm.h"
+#include <cstdint>
+
+// Exact temporal graph: the ground truth for the sketch queries, and the exact baseline
+// the sketch is compared against. The edges are kept in a log sorted by time. Vertices
+// get dense ids (their index in `vertices`), and CSR indexes list the log positions of
+// each vertex's out- and in-edges. Positions are in log order, so each list is in time
+// order. The out-edge weights carry prefix sums. The per-edge index holds each source's
+// out-positions regrouped by target, still in time order within one <s, d>. A time
+// range is then two binary searches in one list.
+// Positions are 32-bit, so a graph holds fewer than 2^32 edges.
+struct ExactGraph {
+    // The edge log, sorted by time
+    std::vector<int> src;
+    std::vector<int> dst;
+    std::vector<int> weight;
+    std::vector<int> time;
+
+    std::vector<int> vertices; // sorted vertex ids
+    std::vector<std::uint32_t> outStart; // out-edges of vertex v: outPos[outStart[v], outStart[v + 1])
+    std::vector<std::uint32_t> outPos;
+    std::vector<long long> outPrefix; // outPrefix[k] = total weight of outPos[0, k)
+    std::vector<std::uint32_t> inStart; // in-edges of vertex v: inPos[inStart[v], inStart[v + 1])
+    std::vector<std::uint32_t> inPos;
+    std::vector<std::uint32_t> pairPos; // outPos of each source, stably sorted by target
+
+    explicit ExactGraph(const std::vector<Edge>& edges);
+    // From count edges stored as columns (a binary edge cache), read in place
+    ExactGraph(const std::int32_t* source, const std::int32_t* target, const std::int32_t* weight,
+               const std::int32_t* time, std::size_t count);
+
+    // Dense id of vertex v, -1 if it has no edge
+    int vertexId(int v) const;
+    // Bytes held by the log and the indexes
+    std::size_t memoryBytes() const;
+};
+
+// Same queries as the sketch, answered exactly over every edge of the graph
+bool vertexQuery(const ExactGraph& graph, int v, int t_b, int t_e);
+long long totalOutgoingWeight(const ExactGraph& graph, int v, int t_b, int t_e);
+int outgoingEdgeCount(const ExactGraph& graph, int v, int t_b, int t_e);
+bool checkVertexRelationship(const ExactGraph& graph, std::pair<int, int> vertexPair, int t_b, int t_e);
+
+// Subgraph query: total weight of the subgraph edges within [t_b, t_e]. With earlyExit,
+// -1 if one of them has no edge in the range (as subgraphQuery on the sketch).
+long long subgraphQuery(const ExactGraph& graph, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit = true);
+
+// Reachability query: is there a path of one or more edges from s to d using only edges
+// within [t_b, t_e]. Bidirectional search that always grows the smaller frontier.
+bool reachabilityQuery(const ExactGraph& graph, std::pair<int, int> startEndPair, int t_b, int t_e);
+
+#endif
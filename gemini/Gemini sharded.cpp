@@ -0,0 +1,197 @@
+#include "Gemini sharded.h"
+
+// Wait until ready() holds: re-check SHARD_SPIN_LIMIT times, then record what is
+// awaited in `parked` and sleep on the shard's condition variable. The fence orders
+// the record before the last check, pairing with the fence of the waking side, so a
+// wake-up cannot be lost.
+template <typename Ready>
+static void waitOrPark(ShardedSketch::Shard& shard, std::atomic<int>& parked, int reason, Ready ready) {
+    for (int i = 0; i < SHARD_SPIN_LIMIT; ++i) {
+        if (ready()) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    parked.store(reason, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    shard.wake.wait(lock, ready);
+    parked.store(ShardedSketch::NOT_PARKED, std::memory_order_relaxed);
+}
+
+static void wake(ShardedSketch::Shard& shard) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.wake.notify_all();
+}
+
+// Room the dispatcher waits for when the queue is full: half of the queue
+static bool hasRoom(const ShardedSketch::Shard& shard) {
+    return shard.queue.size() <= shard.queue.capacity() / 2;
+}
+
+// Worker side, after applying a block: wake the dispatcher only once what it waits
+// for holds, half of the queue free or, for a flush, every edge applied
+static void wakeDispatcher(ShardedSketch::Shard& shard) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int parked = shard.dispatcherParked.load(std::memory_order_relaxed);
+    if ((parked == ShardedSketch::PARKED_FOR_ROOM && hasRoom(shard)) ||
+        (parked == ShardedSketch::PARKED_FOR_FLUSH && shard.queue.size() == 0)) {
+        wake(shard);
+    }
+}
+
+// Dispatcher side, after a push: wake the worker if it is parked
+static void wakeWorker(ShardedSketch::Shard& shard) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard.workerParked.load(std::memory_order_relaxed) != ShardedSketch::NOT_PARKED) {
+        wake(shard);
+    }
+}
+
+// Ingest worker: drain the shard's queue a block at a time into its sketch
+static void runShard(ShardedSketch::Shard& shard, const std::atomic<bool>& stopping) {
+    std::vector<Edge> block;
+    block.reserve(INSERT_BATCH_BLOCK);
+    while (true) {
+        block.clear();
+        if (shard.queue.pop(block, INSERT_BATCH_BLOCK) == 0) {
+            // Every push happens before stopping is set, so one more pop drains the rest
+            if (stopping.load(std::memory_order_acquire) && shard.queue.pop(block, INSERT_BATCH_BLOCK) == 0) {
+                return;
+            }
+            if (block.empty()) {
+                waitOrPark(shard, shard.workerParked, ShardedSketch::PARKED_FOR_EDGES,
+                           [&]() { return shard.queue.size() > 0 || stopping.load(std::memory_order_acquire); });
+                continue;
+            }
+        }
+        insertBatch(shard.sketch, block);
+        shard.applied.fetch_add(static_cast<long long>(block.size()), std::memory_order_release);
+        wakeDispatcher(shard);
+    }
+}
+
+ShardedSketch::ShardedSketch(int shardCount, int size, int T, unsigned seed, int chainLength, std::size_t queueCapacity)
+    : shardHasher(shardCount, seed ^ 0x5BD1E995u), stopping(false), started(false) {
+    for (int k = 0; k < shardCount; ++k) {
+        shards.push_back(std::unique_ptr<Shard>(new Shard(size, T, seed, chainLength, queueCapacity)));
+    }
+    for (int k = 0; k < shardCount; ++k) {
+        Shard& shard = *shards[k];
+        shard.worker = std::thread([&shard, this]() { runShard(shard, stopping); });
+    }
+}
+
+ShardedSketch::~ShardedSketch() {
+    stopping.store(true, std::memory_order_release);
+    for (std::size_t k = 0; k < shards.size(); ++k) {
+        wake(*shards[k]);
+        shards[k]->worker.join();
+    }
+}
+
+// Line the periods of all shards up on the first edge; each worker sees this start
+// through the release of its first push
+static void startShards(ShardedSketch& sketch, int now) {
+    for (std::size_t k = 0; k < sketch.shards.size(); ++k) {
+        sketch.shards[k]->sketch.start = now;
+        sketch.shards[k]->sketch.started = true;
+    }
+    sketch.started = true;
+}
+
+// Push edges[0, count) to the shard's queue, waiting for room as needed
+static void dispatch(ShardedSketch::Shard& shard, const Edge* edges, std::size_t count) {
+    std::size_t pushed = 0;
+    while (pushed < count) {
+        std::size_t n = shard.queue.push(edges + pushed, count - pushed);
+        if (n == 0) {
+            waitOrPark(shard, shard.dispatcherParked, ShardedSketch::PARKED_FOR_ROOM, [&]() { return hasRoom(shard); });
+            continue;
+        }
+        pushed += n;
+        wakeWorker(shard);
+    }
+    shard.dispatched += static_cast<long long>(count);
+}
+
+void insertion(ShardedSketch& sketch, Edge e) {
+    if (!sketch.started) {
+        startShards(sketch, e.time);
+    }
+    dispatch(*sketch.shards[sketch.shardOf(e.sd.first)], &e, 1);
+}
+
+// Split the batch into one run per shard (keeping each shard's edges in order),
+// then hand every run to its queue in one push
+void insertBatch(ShardedSketch& sketch, const Edge* edges, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (!sketch.started) {
+        startShards(sketch, edges[0].time);
+    }
+    for (std::size_t k = 0; k < sketch.shards.size(); ++k) {
+        sketch.shards[k]->run.clear();
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        sketch.shards[sketch.shardOf(edges[i].sd.first)]->run.push_back(edges[i]);
+    }
+    for (std::size_t k = 0; k < sketch.shards.size(); ++k) {
+        ShardedSketch::Shard& shard = *sketch.shards[k];
+        dispatch(shard, shard.run.data(), shard.run.size());
+    }
+}
+
+void insertBatch(ShardedSketch& sketch, const std::vector<Edge>& edges) {
+    insertBatch(sketch, edges.data(), edges.size());
+}
+
+MemoryStats memoryStats(const ShardedSketch& sketch) {
+    MemoryStats stats = MemoryStats();
+    for (std::size_t k = 0; k < sketch.shards.size(); ++k) {
+        MemoryStats shard = memoryStats(sketch.shards[k]->sketch);
+        stats.reservedBytes += shard.reservedBytes;
+        stats.liveBytes += shard.liveBytes;
+        stats.allocations += shard.allocations;
+    }
+    return stats;
+}
+
+void flush(ShardedSketch& sketch) {
+    for (std::size_t k = 0; k < sketch.shards.size(); ++k) {
+        ShardedSketch::Shard& shard = *sketch.shards[k];
+        waitOrPark(shard, shard.dispatcherParked, ShardedSketch::PARKED_FOR_FLUSH,
+                   [&]() { return shard.applied.load(std::memory_order_acquire) == shard.dispatched; });
+    }
+}
+
+// In-edges of v can sit in any shard, so every shard is asked
+bool vertexQuery(const ShardedSketch& sketch, int v, int t_b, int t_e) {
+    for (std::size_t k = 0; k < sketch.shards.size(); ++k) {
+        if (vertexQuery(sketch.shards[k]->sketch, v, t_b, t_e)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int totalOutgoingWeight(const ShardedSketch& sketch, int v, int t_b, int t_e) {
+    return totalOutgoingWeight(sketch.shard(v), v, t_b, t_e);
+}
+
+int outgoingEdgeCount(const ShardedSketch& sketch, int v, int t_b, int t_e) {
+    return outgoingEdgeCount(sketch.shard(v), v, t_b, t_e);
+}
+
+bool checkVertexRelationship(const ShardedSketch& sketch, std::pair<int, int> vertexPair, int t_b, int t_e) {
+    return checkVertexRelationship(sketch.shard(vertexPair.first), vertexPair, t_b, t_e);
+}
+
+std::vector<Edge> findActiveEdges(const ShardedSketch& sketch, int t_b, int t_e) {
+    std::vector<Edge> activeEdges;
+    for (std::size_t k = 0; k < sketch.shards.size(); ++k) {
+        forEachActiveEdge(sketch.shards[k]->sketch, t_b, t_e, [&](const Edge& edge) { activeEdges.push_back(edge); });
+    }
+    return activeEdges;
+}
@@ -0,0 +1,134 @@
+#ifndef GEMINI_SHARDED_H
+#define GEMINI_SHARDED_H
+
+#include "GeminiSketch_Algorithm.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Times a waiting worker or dispatcher re-checks (yielding in between) before it
+// parks on its shard's condition variable
+const int SHARD_SPIN_LIMIT = 64;
+
+// Lock-free single-producer single-consumer queue of edges
+// The dispatcher pushes and one worker pops; head and tail sit on separate cache
+// lines, and the producer keeps a cached copy of head so a push rarely reads it.
+class EdgeQueue {
+public:
+    explicit EdgeQueue(std::size_t capacity)
+        : mask_(static_cast<std::size_t>(nextPowerOfTwo(static_cast<int>(capacity))) - 1),
+          buf_(mask_ + 1, Edge(std::make_pair(0, 0), 0, 0)), head_(0), tail_(0), headCache_(0) {}
+
+    // Producer side: push the longest prefix of edges[0, count) that fits, published
+    // with one release store; return how many were pushed
+    std::size_t push(const Edge* edges, std::size_t count) {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - headCache_ + count > mask_ + 1) {
+            headCache_ = head_.load(std::memory_order_acquire);
+        }
+        std::size_t n = std::min(count, mask_ + 1 - (tail - headCache_));
+        for (std::size_t i = 0; i < n; ++i) {
+            buf_[(tail + i) & mask_] = edges[i];
+        }
+        if (n > 0) {
+            tail_.store(tail + n, std::memory_order_release);
+        }
+        return n;
+    }
+
+    std::size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+    std::size_t capacity() const { return mask_ + 1; }
+
+    // Consumer side: append up to max edges to out, return how many
+    std::size_t pop(std::vector<Edge>& out, std::size_t max) {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        std::size_t n = std::min(tail_.load(std::memory_order_acquire) - head, max);
+        for (std::size_t i = 0; i < n; ++i) {
+            out.push_back(buf_[(head + i) & mask_]);
+        }
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    std::size_t mask_;
+    std::vector<Edge> buf_;
+    char pad0_[CACHE_LINE_SIZE];
+    std::atomic<std::size_t> head_; // next slot to pop, written by the consumer
+    char pad1_[CACHE_LINE_SIZE];
+    std::atomic<std::size_t> tail_; // next slot to push, written by the producer
+    std::size_t headCache_; // producer's last view of head_
+    char pad2_[CACHE_LINE_SIZE];
+};
+
+// Sharded Gemini sketch for multi-threaded ingestion
+// Source vertices are partitioned by a hash of s into shards; each shard is a full
+// Gemini sketch with its own bucket queues, owned by one ingest worker that drains
+// its SPSC queue. The calling thread is the dispatcher: a batch is split into one run
+// per shard, and each run is pushed with a single release store. All shards share
+// one size and seed, so a row or column means the same vertices in every shard.
+// A worker with an empty queue, or a dispatcher facing a full queue or flushing,
+// spins SHARD_SPIN_LIMIT times and then parks on the shard's condition variable, so
+// an idle stream does not keep a core per shard busy. A dispatcher blocked on a full
+// queue waits until half of it is free, so it is woken once per half queue rather
+// than once per block the worker drains.
+struct ShardedSketch {
+    // What a parked thread waits for
+    enum Parked { NOT_PARKED, PARKED_FOR_EDGES, PARKED_FOR_ROOM, PARKED_FOR_FLUSH };
+
+    struct Shard {
+        GeminiSketch sketch;
+        EdgeQueue queue;
+        std::atomic<long long> applied; // edges inserted by the worker
+        long long dispatched; // edges pushed by the dispatcher
+        std::vector<Edge> run; // dispatcher's scratch: this shard's edges of the current batch
+        std::mutex mutex; // guards the parking on wake
+        std::condition_variable wake;
+        std::atomic<int> workerParked; // PARKED_FOR_EDGES while the worker waits for edges (or stopping)
+        std::atomic<int> dispatcherParked; // PARKED_FOR_ROOM or PARKED_FOR_FLUSH while the dispatcher waits
+        std::thread worker;
+        Shard(int size, int T, unsigned seed, int chainLength, std::size_t queueCapacity)
+            : sketch(size, T, seed, chainLength), queue(queueCapacity), applied(0), dispatched(0),
+              workerParked(NOT_PARKED), dispatcherParked(NOT_PARKED) {}
+    };
+
+    Hasher shardHasher; // shard of s = shardHasher.row(s)
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> stopping;
+    bool started;
+
+    // size is the matrix size of each shard
+    ShardedSketch(int shardCount, int size, int T, unsigned seed = 0, int chainLength = 1,
+                  std::size_t queueCapacity = 1 << 16);
+    ~ShardedSketch();
+
+    int shardOf(int s) const { return shardHasher.row(s); }
+    const GeminiSketch& shard(int s) const { return shards[shardOf(s)]->sketch; }
+
+private:
+    ShardedSketch(const ShardedSketch&);
+    ShardedSketch& operator=(const ShardedSketch&);
+};
+
+// Dispatch edges to their shard's queue (blocks while that queue is full)
+void insertion(ShardedSketch& sketch, Edge e);
+void insertBatch(ShardedSketch& sketch, const Edge* edges, std::size_t count);
+void insertBatch(ShardedSketch& sketch, const std::vector<Edge>& edges);
+
+// Memory of all shards together
+MemoryStats memoryStats(const ShardedSketch& sketch);
+
+// Wait until every dispatched edge has been inserted. Queries must run after a flush
+// and before the next dispatch.
+void flush(ShardedSketch& sketch);
+
+// Queries: per-source queries go to the shard of s, the rest merge every shard
+bool vertexQuery(const ShardedSketch& sketch, int v, int t_b, int t_e);
+int totalOutgoingWeight(const ShardedSketch& sketch, int v, int t_b, int t_e);
+int outgoingEdgeCount(const ShardedSketch& sketch, int v, int t_b, int t_e);
+bool checkVertexRelationship(const ShardedSketch& sketch, std::pair<int, int> vertexPair, int t_b, int t_e);
+std::vector<Edge> findActiveEdges(const ShardedSketch& sketch, int t_b, int t_e);
+
+#endif
@@ -1,187 +1,445 @@
-#include <iostream>
-#include <vector>
-#include <utility>
-#include <xxhash.h>
-
-// Define the edge structure
-struct Edge {
-    std::pair<int, int> sd; // <s, d>
-    int weight;
-    int time;
-    Edge(std::pair<int, int> sd, int weight, int time) : sd(sd), weight(weight), time(time) {}
-};
-
-// Define the bucket structure
-struct Bucket {
-    std::pair<int, int> vx; // <s, d>
-    int ec; // edge count
-    int CF; // flag
-    std::vector<Edge> list; // edge list
-    int GT; // timestamp
-    Bucket* bqp; // bucket queue pointer
-    Bucket() : ec(0), CF(0), GT(0), bqp(nullptr) {}
-};
-
-// Define the working matrix structure
-struct WorkingMatrix {
-    std::vector<std::vector<Bucket>> G; // matrix
-    int WS; // working status
-    Bucket* HP; // head pointer
-    Bucket* MP; // middle pointer
-    Bucket* TP; // tail pointer
-    WorkingMatrix(int size) : WS(0), HP(nullptr), MP(nullptr), TP(nullptr) {
-        G.resize(size, std::vector<Bucket>(size));
-    }
-};
-
-// Hash function example
-// Replace with xxhash's hash function
+#include "GeminiSketch_Algorithm.h"
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <malloc.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMINI_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+// Time-range count/sum kernels behind rangeCountSum
+static void rangeCountSumScalar(const int* time, const int* weight, std::size_t n, int t_b, int t_e,
+                                int& count, long long& sum) {
+    int c = 0;
+    long long w = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        bool in = time[i] >= t_b && time[i] <= t_e;
+        c += in;
+        w += in ? weight[i] : 0;
+    }
+    count = c;
+    sum = w;
+}
+
+#ifdef GEMINI_AVX2_KERNEL
+// Eight times per step: the in-range mask is subtracted from a lane counter (-1 per
+// hit) and masks the weights, which are widened to 64 bits before accumulating
+__attribute__((target("avx2")))
+static void rangeCountSumAVX2(const int* time, const int* weight, std::size_t n, int t_b, int t_e,
+                              int& count, long long& sum) {
+    const __m256i lo = _mm256_set1_epi32(t_b);
+    const __m256i hi = _mm256_set1_epi32(t_e);
+    __m256i counts = _mm256_setzero_si256();
+    __m256i sums = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(time + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weight + i));
+        __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(lo, t), _mm256_cmpgt_epi32(t, hi));
+        __m256i in = _mm256_xor_si256(out, _mm256_set1_epi32(-1));
+        counts = _mm256_sub_epi32(counts, in);
+        w = _mm256_and_si256(w, in);
+        sums = _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(w)));
+        sums = _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(w, 1)));
+    }
+
+    alignas(32) int laneCounts[8];
+    alignas(32) long long laneSums[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneCounts), counts);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneSums), sums);
+    int c = 0;
+    long long w = 0;
+    for (int l = 0; l < 8; ++l) {
+        c += laneCounts[l];
+    }
+    for (int l = 0; l < 4; ++l) {
+        w += laneSums[l];
+    }
+
+    int tailCount;
+    long long tailSum;
+    rangeCountSumScalar(time + i, weight + i, n - i, t_b, t_e, tailCount, tailSum);
+    count = c + tailCount;
+    sum = w + tailSum;
+}
+#endif
+
+typedef void (*RangeCountSumKernel)(const int*, const int*, std::size_t, int, int, int&, long long&);
+
+static RangeCountSumKernel selectRangeCountSum() {
+#ifdef GEMINI_AVX2_KERNEL
+    if (__builtin_cpu_supports("avx2")) {
+        return rangeCountSumAVX2;
+    }
+#endif
+    return rangeCountSumScalar;
+}
+
+void rangeCountSum(const int* time, const int* weight, std::size_t n, int t_b, int t_e,
+                   int& count, long long& sum) {
+    static const RangeCountSumKernel kernel = selectRangeCountSum();
+    kernel(time, weight, n, t_b, t_e, count, sum);
+}
+
+// Vertices are hashed with the matrix's own Hasher (see GeminiSketch_Algorithm.h)
 
 // Vertex query algorithm
-// Define the value of g, which can be adjusted according to actual conditions
-const int g = 1;
+// The hash chain length g is set per matrix (WorkingMatrix::g)
 
 // Modify the vertex query function to include the chain hashing compensation mechanism
 bool vertexQuery(const WorkingMatrix& matrix, int v, int t_b, int t_e) {
-    int r = H(v);
-    for (int offset = 0; offset <= g; ++offset) {
-        int adjusted_r = (r + offset) % matrix.G.size();
-        for (const auto& bucket : matrix.G[adjusted_r]) {
-            if (bucket.vx.first == v || bucket.vx.second == v) {
-                for (const auto& edge : bucket.list) {
-                    if (edge.time >= t_b && edge.time <= t_e) {
-                        return true;
-                    }
-                }
+    // Outgoing edges of v are in its row (and the chained rows after it)
+    int r = matrix.hasher.row(v);
+    for (int offset = 0; offset <= matrix.g; ++offset) {
+        int adjusted_r = matrix.probe(r, offset);
+        const Bucket* row = matrix.row(adjusted_r);
+        for (int j = 0; j < matrix.size(); ++j) {
+            if (row[j].vx.first == v && matrix.list(matrix.index(adjusted_r, j)).countInRange(t_b, t_e) > 0) {
+                return true;
             }
         }
     }
+    // Incoming edges of v are all in its column
+    int c = matrix.hasher.col(v);
+    for (int i = 0; i < matrix.size(); ++i) {
+        if (matrix.bucket(i, c).vx.second == v && matrix.list(matrix.index(i, c)).countInRange(t_b, t_e) > 0) {
+            return true;
+        }
+    }
     return false;
 }
 
 // Other query functions can be modified similarly, such as totalOutgoingWeight, outgoingEdgeCount, etc.
 
-// Calculate the total outgoing edge weight of vertex v within [t_b, t_e]
-int totalOutgoingWeight(const WorkingMatrix& matrix, int v, int t_b, int t_e) {
-    int totalWeight = 0;
-    int r = H(v);
-    for (const auto& bucket : matrix.G[r]) {
-        if (bucket.vx.first == v) {
-            for (const auto& edge : bucket.list) {
-                if (edge.time >= t_b && edge.time <= t_e) {
-                    totalWeight += edge.weight;
+// Call visit(k) for every bucket k on v's hash chain with source v whose [FT, GT]
+// span meets [t_b, t_e]. The hot bucket metadata is scanned first and the matches of
+// each block have their ring, then its columns, prefetched before visit reads them.
+template <typename Visitor>
+static void forEachOutgoingBucket(const WorkingMatrix& matrix, int v, int t_b, int t_e, Visitor visit) {
+    std::size_t matches[QUERY_PREFETCH_BLOCK];
+    int r = matrix.hasher.row(v);
+    for (int offset = 0; offset <= matrix.g; ++offset) {
+        int adjusted_r = matrix.probe(r, offset);
+        const Bucket* row = matrix.row(adjusted_r);
+        int j = 0;
+        while (j < matrix.size()) {
+            std::size_t count = 0;
+            for (; j < matrix.size() && count < QUERY_PREFETCH_BLOCK; ++j) {
+                if (row[j].vx.first == v && row[j].GT >= t_b && row[j].FT <= t_e) {
+                    matches[count] = matrix.index(adjusted_r, j);
+                    prefetchRing(matrix, matches[count]);
+                    ++count;
                 }
             }
+            for (std::size_t m = 0; m < count; ++m) {
+                prefetchColumns(matrix, matches[m]);
+            }
+            for (std::size_t m = 0; m < count; ++m) {
+                visit(matches[m]);
+            }
         }
     }
-    return totalWeight;
+}
+
+// Calculate the total outgoing edge weight of vertex v within [t_b, t_e]
+int totalOutgoingWeight(const WorkingMatrix& matrix, int v, int t_b, int t_e) {
+    long long totalWeight = 0;
+    forEachOutgoingBucket(matrix, v, t_b, t_e, [&](std::size_t k) {
+        // Range sum over the bucket's time/weight columns
+        totalWeight += matrix.list(k).weightInRange(t_b, t_e);
+    });
+    return static_cast<int>(totalWeight);
 }
 
 // Calculate the number of outgoing edges of vertex v within [t_b, t_e]
 int outgoingEdgeCount(const WorkingMatrix& matrix, int v, int t_b, int t_e) {
     int count = 0;
-    int r = H(v);
-    for (const auto& bucket : matrix.G[r]) {
-        if (bucket.vx.first == v) {
-            for (const auto& edge : bucket.list) {
-                if (edge.time >= t_b && edge.time <= t_e) {
-                    count++;
-                }
-            }
+    forEachOutgoingBucket(matrix, v, t_b, t_e, [&](std::size_t k) {
+        // A span inside the range counts the whole bucket, which ec already holds
+        const Bucket& bucket = matrix.G[k];
+        count += bucket.FT >= t_b && bucket.GT <= t_e ? bucket.ec : matrix.list(k).countInRange(t_b, t_e);
+    });
+    return count;
+}
+
+// Process-wide totals of the tracked blocks; relaxed, since they are only read as a snapshot
+static std::atomic<std::size_t> heapRequested(0);
+static std::atomic<std::size_t> heapReserved(0);
+static std::atomic<std::size_t> heapAllocations(0);
+static std::atomic<std::size_t> heapLiveBlocks(0);
+
+// glibc keeps a size word in front of every chunk, outside the usable size
+static const std::size_t MALLOC_HEADER_BYTES = sizeof(std::size_t);
+
+std::size_t reservedBytes(const void* p) {
+    return p == nullptr ? 0 : malloc_usable_size(const_cast<void*>(p)) + MALLOC_HEADER_BYTES;
+}
+
+void* trackedAllocate(std::size_t bytes, std::size_t alignment) {
+    void* p = nullptr;
+    if (alignment > 0) {
+        if (posix_memalign(&p, alignment, bytes) != 0) {
+            p = nullptr;
         }
+    } else {
+        p = std::malloc(bytes);
     }
-    return count;
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    heapRequested.fetch_add(bytes, std::memory_order_relaxed);
+    heapReserved.fetch_add(reservedBytes(p), std::memory_order_relaxed);
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    heapLiveBlocks.fetch_add(1, std::memory_order_relaxed);
+    return p;
 }
-int H(int x) {
-    return XXH32(&x, sizeof(x), 0) % 10;
+
+void trackedRelease(void* p, std::size_t bytes) {
+    if (p == nullptr) {
+        return;
+    }
+    heapRequested.fetch_sub(bytes, std::memory_order_relaxed);
+    heapReserved.fetch_sub(reservedBytes(p), std::memory_order_relaxed);
+    heapLiveBlocks.fetch_sub(1, std::memory_order_relaxed);
+    std::free(p);
+}
+
+HeapStats heapStats() {
+    HeapStats stats;
+    stats.requestedBytes = heapRequested.load(std::memory_order_relaxed);
+    stats.reservedBytes = heapReserved.load(std::memory_order_relaxed);
+    stats.allocations = heapAllocations.load(std::memory_order_relaxed);
+    stats.liveBlocks = heapLiveBlocks.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// The second field of /proc/self/statm is the resident page count
+std::size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    std::size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+MemoryStats memoryStats(const WorkingMatrix& matrix) {
+    MemoryStats stats;
+    stats.reservedBytes = sizeof(matrix) + reservedBytes(matrix.G.data()) + reservedBytes(matrix.L.data());
+    stats.liveBytes = sizeof(matrix) + matrix.cells() * (sizeof(Bucket) + sizeof(EdgeRing));
+    stats.allocations = (matrix.G.data() != nullptr) + (matrix.L.data() != nullptr);
+    for (std::size_t k = 0; k < matrix.cells(); ++k) {
+        const EdgeRing& list = matrix.list(k);
+        if (list.storage() != nullptr) {
+            stats.reservedBytes += reservedBytes(list.storage());
+            stats.liveBytes += list.size() * EdgeRing::slotBytes();
+            stats.allocations += 1;
+        }
+    }
+    return stats;
+}
+
+MemoryStats memoryStats(const GeminiSketch& sketch) {
+    MemoryStats m0 = memoryStats(sketch.M0);
+    MemoryStats m1 = memoryStats(sketch.M1);
+    MemoryStats stats;
+    stats.reservedBytes = m0.reservedBytes + m1.reservedBytes;
+    stats.liveBytes = m0.liveBytes + m1.liveBytes;
+    stats.allocations = m0.allocations + m1.allocations;
+    return stats;
+}
+
+int matrixSizeForBudget(std::size_t bytes) {
+    std::size_t cell = sizeof(Bucket) + sizeof(EdgeRing);
+    int size = 1;
+    while (static_cast<std::size_t>(size + 1) * (size + 1) * cell <= bytes) {
+        size += 1;
+    }
+    return size;
 }
 
 // Insertion operation
-void insertion(WorkingMatrix& matrix, Edge e) {
-    int i = H(e.sd.first);
-    int j = H(e.sd.second);
+// Insert e into row i, column j (its precomputed hashes); returns the bucket taken
+static int insertAt(WorkingMatrix& matrix, const Edge& e, int i, int j) {
+    // Walk the chain once: stop at the bucket holding <s, d>, remember the first free one
+    int slot = -1;
+    int slotOffset = 0;
+    for (int offset = 0; offset <= matrix.g; ++offset) {
+        int k = static_cast<int>(matrix.index(matrix.probe(i, offset), j));
+        Bucket& bucket = matrix.G[k];
+        if (bucket.CF != 0 && bucket.vx == e.sd) {
+            bucket.ec += 1;
+            matrix.list(k).push_back(e);
+            bucket.GT = std::max(bucket.GT, e.time);
+            bucket.FT = std::min(bucket.FT, e.time);
+            return k;
+        }
+        if (bucket.CF == 0 && slot == -1) {
+            slot = k;
+            slotOffset = offset;
+        }
+    }
 
-    for (; ; ) {
-        if (matrix.G[i][j].vx == e.sd || matrix.G[i][j].vx == std::make_pair(0, 0)) {
-            break;
-        } else {
-            matrix.G[i][j].CF = 0;
+    if (slot == -1) {
+        // Overflow policy: the chain is full of other edges, drop the edge
+        matrix.overflow += 1;
+        return -1;
+    }
+
+    Bucket& bucket = matrix.G[slot];
+    bucket.ec += 1;
+    bucket.vx = e.sd;
+    bucket.CF = slotOffset + 1;
+    matrix.list(slot).push_back(e);
+    bucket.GT = e.time;
+    bucket.FT = e.time;
+
+    if (matrix.TP == -1) {
+        matrix.HP = slot;
+        matrix.TP = slot;
+    } else {
+        matrix.G[matrix.TP].bqp = slot;
+        bucket.bqb = matrix.TP;
+        matrix.TP = slot;
+    }
+    return slot;
+}
+
+int insertion(WorkingMatrix& matrix, Edge e) {
+    return insertAt(matrix, e, matrix.hasher.row(e.sd.first), matrix.hasher.col(e.sd.second));
+}
+
+// Hint the cache that bucket k and its edge ring are about to be written
+static inline void prefetchBucket(const WorkingMatrix& matrix, std::size_t k) {
+#if defined(__GNUC__)
+    __builtin_prefetch(&matrix.G[k], 1, 1);
+    __builtin_prefetch(&matrix.L[k], 1, 1);
+#else
+    (void)matrix;
+    (void)k;
+#endif
+}
+
+// Insert edges[begin, end) block by block: hash the whole block first, prefetch the
+// home bucket of every edge, then apply the inserts while the lines arrive
+static void insertRange(WorkingMatrix& matrix, const Edge* edges, std::size_t begin, std::size_t end) {
+    int rows[INSERT_BATCH_BLOCK];
+    int cols[INSERT_BATCH_BLOCK];
+    while (begin < end) {
+        std::size_t count = std::min(end - begin, INSERT_BATCH_BLOCK);
+        for (std::size_t b = 0; b < count; ++b) {
+            const Edge& e = edges[begin + b];
+            rows[b] = matrix.hasher.row(e.sd.first);
+            cols[b] = matrix.hasher.col(e.sd.second);
+            prefetchBucket(matrix, matrix.index(rows[b], cols[b]));
         }
+        for (std::size_t b = 0; b < count; ++b) {
+            insertAt(matrix, edges[begin + b], rows[b], cols[b]);
+        }
+        begin += count;
     }
+}
 
-    if (matrix.G[i][j].vx == std::make_pair(0, 0)) {
-        matrix.G[i][j].ec += 1;
-        matrix.G[i][j].vx = e.sd;
-        matrix.G[i][j].CF = 1;
-        matrix.G[i][j].list.push_back(e);
-        matrix.G[i][j].GT = e.time;
+void insertBatch(WorkingMatrix& matrix, const Edge* edges, std::size_t count) {
+    insertRange(matrix, edges, 0, count);
+}
 
-        if (matrix.TP == nullptr) {
-            matrix.HP = &matrix.G[i][j];
-            matrix.MP = &matrix.G[i][j];
-            matrix.TP = &matrix.G[i][j];
-        } else {
-            matrix.TP->bqp = &matrix.G[i][j];
-            matrix.TP = &matrix.G[i][j];
+void insertBatch(WorkingMatrix& matrix, const std::vector<Edge>& edges) {
+    insertBatch(matrix, edges.data(), edges.size());
+}
+
+// Find the bucket holding <s, d> on its hash chain
+int findBucket(const WorkingMatrix& matrix, std::pair<int, int> sd) {
+    int i = matrix.hasher.row(sd.first);
+    int j = matrix.hasher.col(sd.second);
+    for (int offset = 0; offset <= matrix.g; ++offset) {
+        int k = static_cast<int>(matrix.index(matrix.probe(i, offset), j));
+        if (matrix.G[k].CF != 0 && matrix.G[k].vx == sd) {
+            return k;
         }
+    }
+    return -1;
+}
+
+// Unlink bucket k from the virtual bucket queue and reset it to free
+void releaseBucket(WorkingMatrix& matrix, int k) {
+    Bucket& bucket = matrix.G[k];
+    if (bucket.bqb != -1) {
+        matrix.G[bucket.bqb].bqp = bucket.bqp;
+    } else {
+        matrix.HP = bucket.bqp;
+    }
+    if (bucket.bqp != -1) {
+        matrix.G[bucket.bqp].bqb = bucket.bqb;
     } else {
-        matrix.G[i][j].ec += 1;
-        // Other processing...
+        matrix.TP = bucket.bqb;
     }
+    if (matrix.MP == k) {
+        matrix.MP = bucket.bqp;
+    }
+    bucket = Bucket();
+    matrix.list(k).clear();
+}
+
+// Drop the expired edges of bucket k, releasing it once it is empty
+bool expireBucket(WorkingMatrix& matrix, int k, int Te) {
+    Bucket& bucket = matrix.G[k];
+    if (bucket.FT > Te) {
+        return false;
+    }
+    EdgeRing& list = matrix.list(k);
+    while (!list.empty() && list.time(0) <= Te) {
+        list.pop_front();
+        bucket.ec -= 1;
+    }
+    if (list.empty()) {
+        releaseBucket(matrix, k);
+        return true;
+    }
+    bucket.FT = list.time(0);
+    return false;
 }
 
 // Eliminate expired edges operation
-void eliminateExpiredEdges(WorkingMatrix& matrix, int Te) {
-    if (matrix.MP != nullptr && matrix.MP->list.front().time <= Te) {
-        Bucket* WP = matrix.HP;
-        while (WP != matrix.MP) {
-            while (!WP->list.empty() && WP->list.front().time <= Te) {
-                WP->ec -= 1;
-                if (WP->ec == 0) {
-                    Bucket* NB = WP;
-                    WP = WP->bqp;
-                    // Remove NB from virtual bucket queue...
-                } else {
-                    WP->list.erase(WP->list.begin());
-                }
-            }
-            WP = WP->bqp;
+void eliminateExpiredEdges(WorkingMatrix& matrix, int Te, int budget) {
+    if (budget < 0) {
+        int WP = matrix.HP;
+        while (WP != -1) {
+            int next = matrix.G[WP].bqp;
+            expireBucket(matrix, WP, Te);
+            WP = next;
         }
+        matrix.MP = -1;
+        return;
+    }
 
-        while (!matrix.MP->list.empty() && matrix.MP->list.front().time <= Te) {
-            Bucket* S = matrix.MP;
-            // Process S...
-        }
+    int WP = matrix.MP == -1 ? matrix.HP : matrix.MP;
+    for (int step = 0; step < budget && WP != -1; ++step) {
+        int next = matrix.G[WP].bqp;
+        expireBucket(matrix, WP, Te);
+        // Wrap around to the head once the tail has been processed
+        WP = next == -1 ? matrix.HP : next;
     }
+    matrix.MP = WP;
 }
 
 // Time-related query: Find all active edges within [t_b, t_e]
 std::vector<Edge> findActiveEdges(const WorkingMatrix& matrix, int t_b, int t_e) {
     std::vector<Edge> activeEdges;
-    for (const auto& row : matrix.G) {
-        for (const auto& bucket : row) {
-            for (const auto& edge : bucket.list) {
-                if (edge.time >= t_b && edge.time <= t_e) {
-                    activeEdges.push_back(edge);
-                }
-            }
-        }
-    }
+    forEachActiveEdge(matrix, t_b, t_e, [&](const Edge& edge) { activeEdges.push_back(edge); });
     return activeEdges;
 }
 
 // Time-related query: Check the relationship between vertices within [t_b, t_e]
+// The edge can only live on its own hash chain, so this is O(g) rather than a matrix scan
 bool checkVertexRelationship(const WorkingMatrix& matrix, std::pair<int, int> vertexPair, int t_b, int t_e) {
-    for (const auto& row : matrix.G) {
-        for (const auto& bucket : row) {
-            for (const auto& edge : bucket.list) {
-                if (edge.sd == vertexPair && edge.time >= t_b && edge.time <= t_e) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    int k = findBucket(matrix, vertexPair);
+    return k != -1 && matrix.list(k).countInRange(t_b, t_e) > 0;
 }
 
 // Reachability query
@@ -191,100 +449,474 @@ float averageHashChainLength(const WorkingMatrix& matrix) {
     int totalChains = 0;
     int totalLength = 0;
 
-    for (const auto& row : matrix.G) {
-        for (const auto& bucket : row) {
-            if (!bucket.list.empty()) {
-                totalChains++;
-                totalLength += bucket.list.size();
-            }
+    for (std::size_t k = 0; k < matrix.cells(); ++k) {
+        if (!matrix.list(k).empty()) {
+            totalChains++;
+            totalLength += matrix.list(k).size();
         }
     }
 
     return (totalChains == 0) ? 0 : static_cast<float>(totalLength) / totalChains;
 }
 
-bool reachabilityQuery(const WorkingMatrix& matrix, std::pair<int, int> startEndPair, int t_b, int t_e) {
-    // Simple implementation, can be optimized according to actual requirements
-    std::vector<Edge> activeEdges = findActiveEdges(matrix, t_b, t_e);
-    std::vector<int> visited;
-    std::vector<int> queue;
-    queue.push_back(startEndPair.first);
-
-    while (!queue.empty()) {
-        int current = queue.back();
-        queue.pop_back();
-        visited.push_back(current);
-
-        for (const auto& edge : activeEdges) {
-            if (edge.sd.first == current && std::find(visited.begin(), visited.end(), edge.sd.second) == visited.end()) {
-                if (edge.sd.second == startEndPair.second) {
-                    return true;
-                }
-                queue.push_back(edge.sd.second);
+// Expand row r: queue the row of every neighbour reached from a bucket homed in r
+// (chain offset CF - 1) with an edge in [t_b, t_e]; true as soon as dst is a neighbour
+static bool expandRow(const WorkingMatrix& matrix, int r, int dst, int t_b, int t_e,
+                      DenseBitset& visited, std::vector<int>& frontier) {
+    for (int offset = 0; offset <= matrix.g; ++offset) {
+        int adjusted_r = matrix.probe(r, offset);
+        const Bucket* row = matrix.row(adjusted_r);
+        for (int j = 0; j < matrix.size(); ++j) {
+            if (row[j].CF != offset + 1 || !bucketInRange(matrix, matrix.index(adjusted_r, j), t_b, t_e)) {
+                continue;
+            }
+            if (row[j].vx.second == dst) {
+                return true;
             }
+            int next = matrix.hasher.row(row[j].vx.second);
+            if (!visited.test(next)) {
+                visited.set(next);
+                frontier.push_back(next);
+            }
+        }
+    }
+    return false;
+}
+
+static bool expandRow(const GeminiSketch& sketch, int r, int dst, int t_b, int t_e,
+                      DenseBitset& visited, std::vector<int>& frontier) {
+    return expandRow(sketch.aging(), r, dst, t_b, t_e, visited, frontier) ||
+           expandRow(sketch.active(), r, dst, t_b, t_e, visited, frontier);
+}
+
+// Breadth-first search over rows from H(src), stopping at the first edge into dst
+template <typename Sketch>
+static bool reachable(const Sketch& sketch, const WorkingMatrix& layout, std::pair<int, int> startEndPair, int t_b, int t_e) {
+    DenseBitset visited(layout.size());
+    std::vector<int> frontier;
+    int source = layout.hasher.row(startEndPair.first);
+    visited.set(source);
+    frontier.push_back(source);
+
+    for (std::size_t head = 0; head < frontier.size(); ++head) {
+        if (expandRow(sketch, frontier[head], startEndPair.second, t_b, t_e, visited, frontier)) {
+            return true;
         }
     }
     return false;
 }
 
+bool reachabilityQuery(const WorkingMatrix& matrix, std::pair<int, int> startEndPair, int t_b, int t_e) {
+    return reachable(matrix, matrix, startEndPair, t_b, t_e);
+}
+
+// In-range weight of <s, d>, -1 if it has no edge within [t_b, t_e]
+static long long edgeWeight(const WorkingMatrix& matrix, std::pair<int, int> sd, int t_b, int t_e) {
+    int k = findBucket(matrix, sd);
+    if (k == -1 || !bucketInRange(matrix, k, t_b, t_e)) {
+        return -1;
+    }
+    return matrix.list(k).weightInRange(t_b, t_e);
+}
 
-int subgraphQuery(const WorkingMatrix& matrix, const std::vector<Edge>& subgraph, int t_b, int t_e) {
-    std::vector<Edge> activeEdges = findActiveEdges(matrix, t_b, t_e);
-    int totalWeight = 0;
+static long long edgeWeight(const GeminiSketch& sketch, std::pair<int, int> sd, int t_b, int t_e) {
+    long long aging = edgeWeight(sketch.aging(), sd, t_b, t_e);
+    long long active = edgeWeight(sketch.active(), sd, t_b, t_e);
+    if (aging == -1 && active == -1) {
+        return -1;
+    }
+    return std::max(aging, 0LL) + std::max(active, 0LL);
+}
 
-    for (const auto& subEdge : subgraph) {
-        bool found = false;
-        for (const auto& edge : activeEdges) {
-            if (subEdge.sd == edge.sd && edge.time >= t_b && edge.time <= t_e) {
-                found = true;
-                totalWeight += edge.weight;
-                break;
-            }
+// Sum the weights of subgraph[begin, end), flagging a missing edge in `missing`
+template <typename Sketch>
+static long long subgraphRange(const Sketch& sketch, const std::vector<Edge>& subgraph, std::size_t begin, std::size_t end,
+                               int t_b, int t_e, bool earlyExit, std::atomic<bool>& missing) {
+    long long totalWeight = 0;
+    for (std::size_t i = begin; i < end; ++i) {
+        if (earlyExit && missing.load(std::memory_order_relaxed)) {
+            break;
         }
-        if (!found) {
-            return -1; 
+        long long weight = edgeWeight(sketch, subgraph[i].sd, t_b, t_e);
+        if (weight == -1) {
+            missing.store(true, std::memory_order_relaxed);
+        } else {
+            totalWeight += weight;
         }
     }
-
     return totalWeight;
 }
 
-int main() {
-    WorkingMatrix matrix(10);
-    Edge e(std::make_pair(1, 2), 10, 1);
-    insertion(matrix, e);
-    eliminateExpiredEdges(matrix, 2);
+template <typename Sketch>
+static int subgraphWeight(const Sketch& sketch, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit) {
+    std::atomic<bool> missing(false);
+    long long totalWeight = 0;
 
+    std::size_t workers = std::thread::hardware_concurrency();
+    if (subgraph.size() < PARALLEL_SUBGRAPH_EDGES || workers < 2) {
+        totalWeight = subgraphRange(sketch, subgraph, 0, subgraph.size(), t_b, t_e, earlyExit, missing);
+    } else {
+        // Contiguous slices, one per worker; the calling thread takes the last one
+        std::vector<long long> partial(workers, 0);
+        std::vector<std::thread> threads;
+        std::size_t slice = (subgraph.size() + workers - 1) / workers;
+        for (std::size_t w = 0; w + 1 < workers; ++w) {
+            std::size_t begin = std::min(w * slice, subgraph.size());
+            std::size_t end = std::min(begin + slice, subgraph.size());
+            threads.emplace_back([&, w, begin, end]() {
+                partial[w] = subgraphRange(sketch, subgraph, begin, end, t_b, t_e, earlyExit, missing);
+            });
+        }
+        std::size_t begin = std::min((workers - 1) * slice, subgraph.size());
+        partial[workers - 1] = subgraphRange(sketch, subgraph, begin, subgraph.size(), t_b, t_e, earlyExit, missing);
+        for (std::size_t w = 0; w < threads.size(); ++w) {
+            threads[w].join();
+        }
+        for (std::size_t w = 0; w < workers; ++w) {
+            totalWeight += partial[w];
+        }
+    }
 
-    std::vector<Edge> activeEdges = findActiveEdges(matrix, 0, 3);
-    std::cout << "Active edges count: " << activeEdges.size() << std::endl;
+    return (earlyExit && missing.load()) ? -1 : static_cast<int>(totalWeight);
+}
 
-    bool related = checkVertexRelationship(matrix, std::make_pair(1, 2), 0, 3);
-    std::cout << "Vertex relationship: " << (related ? "Yes" : "No") << std::endl;
+int subgraphQuery(const WorkingMatrix& matrix, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit) {
+    return subgraphWeight(matrix, subgraph, t_b, t_e, earlyExit);
+}
 
-    bool reachable = reachabilityQuery(matrix, std::make_pair(1, 2), 0, 3);
-    std::cout << "Reachability: " << (reachable ? "Yes" : "No") << std::endl;
+// Reset every bucket on the bucket queue
+void clearMatrix(WorkingMatrix& matrix) {
+    int k = matrix.HP;
+    while (k != -1) {
+        int next = matrix.G[k].bqp;
+        matrix.G[k] = Bucket();
+        matrix.list(k).clear();
+        k = next;
+    }
+    matrix.HP = -1;
+    matrix.MP = -1;
+    matrix.TP = -1;
+}
 
+void copyMatrix(const WorkingMatrix& from, WorkingMatrix& to) {
+    for (std::size_t k = 0; k < from.cells(); ++k) {
+        to.G[k] = from.G[k];
+        to.list(k).assign(from.list(k));
+    }
+    to.hasher = from.hasher;
+    to.g = from.g;
+    to.overflow = from.overflow;
+    to.WS = from.WS;
+    to.HP = from.HP;
+    to.MP = from.MP;
+    to.TP = from.TP;
+}
 
+// Clear the aging matrix and make it the active one
+void switchMatrices(GeminiSketch& sketch) {
+    WorkingMatrix& aging = sketch.aging();
+    WorkingMatrix& active = sketch.active();
+    clearMatrix(aging);
+    aging.WS = 1;
+    active.WS = 0;
+}
 
-    bool vertexFound = vertexQuery(matrix, 1, 0, 3);
-    std::cout << "Vertex found: " << (vertexFound ? "Yes" : "No") << std::endl;
+void copySketch(const GeminiSketch& from, GeminiSketch& to) {
+    copyMatrix(from.M0, to.M0);
+    copyMatrix(from.M1, to.M1);
+    to.T = from.T;
+    to.start = from.start;
+    to.started = from.started;
+}
 
-    int outgoingWeight = totalOutgoingWeight(matrix, 1, 0, 3);
-    std::cout << "Total outgoing weight: " << outgoingWeight << std::endl;
+// Move the sketch's clock to the time of an arriving edge, switching (or clearing
+// both) matrices when it passes a period boundary
+static void advanceTime(GeminiSketch& sketch, int now) {
+    if (!sketch.started) {
+        sketch.start = now;
+        sketch.started = true;
+    }
 
-    int outgoingCount = outgoingEdgeCount(matrix, 1, 0, 3);
-    std::cout << "Outgoing edge count: " << outgoingCount << std::endl;
+    if (now >= sketch.start + sketch.T) {
+        if (now >= sketch.start + 2 * sketch.T) {
+            // Both periods are out of the window: drop both matrices
+            clearMatrix(sketch.active());
+            sketch.start += (now - sketch.start) / sketch.T * sketch.T - sketch.T;
+        }
+        switchMatrices(sketch);
+        sketch.start += sketch.T;
+    }
+}
 
+int insertion(GeminiSketch& sketch, Edge e) {
+    advanceTime(sketch, e.time);
+    return insertion(sketch.active(), e);
+}
 
-    std::vector<Edge> subgraph = {Edge(std::make_pair(1, 2), 10, 1)};
-    int subgraphWeight = subgraphQuery(matrix, subgraph, 0, 3);
-    if (subgraphWeight == -1) {
-        std::cout << "Subgraph is not exactly matched." << std::endl;
-    } else {
-        std::cout << "Subgraph total weight: " << subgraphWeight << std::endl;
+void insertBatch(GeminiSketch& sketch, const Edge* edges, std::size_t count) {
+    std::size_t i = 0;
+    while (i < count) {
+        // The edge that opens a new period goes through insertion() to switch matrices
+        insertion(sketch, edges[i++]);
+
+        // Every edge before the next period boundary lands in the same active matrix
+        std::size_t end = i;
+        while (end < count && edges[end].time < sketch.start + sketch.T) {
+            ++end;
+        }
+        insertRange(sketch.active(), edges, i, end);
+        i = end;
     }
+}
+
+void insertBatch(GeminiSketch& sketch, const std::vector<Edge>& edges) {
+    insertBatch(sketch, edges.data(), edges.size());
+}
+
+bool vertexQuery(const GeminiSketch& sketch, int v, int t_b, int t_e) {
+    return vertexQuery(sketch.active(), v, t_b, t_e) || vertexQuery(sketch.aging(), v, t_b, t_e);
+}
 
-    return 0;
+int totalOutgoingWeight(const GeminiSketch& sketch, int v, int t_b, int t_e) {
+    return totalOutgoingWeight(sketch.active(), v, t_b, t_e) + totalOutgoingWeight(sketch.aging(), v, t_b, t_e);
+}
+
+int outgoingEdgeCount(const GeminiSketch& sketch, int v, int t_b, int t_e) {
+    return outgoingEdgeCount(sketch.active(), v, t_b, t_e) + outgoingEdgeCount(sketch.aging(), v, t_b, t_e);
+}
+
+std::vector<Edge> findActiveEdges(const GeminiSketch& sketch, int t_b, int t_e) {
+    std::vector<Edge> activeEdges;
+    forEachActiveEdge(sketch, t_b, t_e, [&](const Edge& edge) { activeEdges.push_back(edge); });
+    return activeEdges;
+}
+
+bool checkVertexRelationship(const GeminiSketch& sketch, std::pair<int, int> vertexPair, int t_b, int t_e) {
+    return checkVertexRelationship(sketch.active(), vertexPair, t_b, t_e) ||
+           checkVertexRelationship(sketch.aging(), vertexPair, t_b, t_e);
+}
+
+bool reachabilityQuery(const GeminiSketch& sketch, std::pair<int, int> startEndPair, int t_b, int t_e) {
+    // Both matrices share one hasher, so a row means the same vertices in each
+    return reachable(sketch, sketch.active(), startEndPair, t_b, t_e);
+}
+
+// Collect the in-range buckets of a matrix as (home row, neighbour row, neighbour) triples
+static void collectRowEdges(const WorkingMatrix& matrix, int t_b, int t_e, std::vector<int>& entries) {
+    for (int i = 0; i < matrix.size(); ++i) {
+        const Bucket* row = matrix.row(i);
+        for (int j = 0; j < matrix.size(); ++j) {
+            if (!bucketInRange(matrix, matrix.index(i, j), t_b, t_e)) {
+                continue;
+            }
+            entries.push_back(matrix.probe(i, matrix.size() - (row[j].CF - 1)));
+            entries.push_back(matrix.hasher.row(row[j].vx.second));
+            entries.push_back(row[j].vx.second);
+        }
+    }
+}
+
+// Counting sort of the triples into the forward and reverse CSR arrays
+static void buildRowIndex(ReachabilitySnapshot& snapshot, int n, const std::vector<int>& entries) {
+    std::size_t m = entries.size() / 3;
+    snapshot.outStart.assign(n + 1, 0);
+    snapshot.inStart.assign(n + 1, 0);
+    for (std::size_t e = 0; e < m; ++e) {
+        snapshot.outStart[entries[3 * e] + 1] += 1;
+        snapshot.inStart[entries[3 * e + 1] + 1] += 1;
+    }
+    for (int r = 0; r < n; ++r) {
+        snapshot.outStart[r + 1] += snapshot.outStart[r];
+        snapshot.inStart[r + 1] += snapshot.inStart[r];
+    }
+
+    snapshot.outRow.resize(m);
+    snapshot.outVertex.resize(m);
+    snapshot.inRow.resize(m);
+    snapshot.inVertex.resize(m);
+    std::vector<int> outNext(snapshot.outStart.begin(), snapshot.outStart.end() - 1);
+    std::vector<int> inNext(snapshot.inStart.begin(), snapshot.inStart.end() - 1);
+    for (std::size_t e = 0; e < m; ++e) {
+        int home = entries[3 * e], next = entries[3 * e + 1], vertex = entries[3 * e + 2];
+        int o = outNext[home]++;
+        snapshot.outRow[o] = next;
+        snapshot.outVertex[o] = vertex;
+        int in = inNext[next]++;
+        snapshot.inRow[in] = home;
+        snapshot.inVertex[in] = vertex;
+    }
+}
+
+ReachabilitySnapshot::ReachabilitySnapshot(const WorkingMatrix& matrix, int t_b, int t_e)
+    : hasher(matrix.hasher), t_b(t_b), t_e(t_e) {
+    std::vector<int> entries;
+    collectRowEdges(matrix, t_b, t_e, entries);
+    buildRowIndex(*this, matrix.size(), entries);
+}
+
+ReachabilitySnapshot::ReachabilitySnapshot(const GeminiSketch& sketch, int t_b, int t_e)
+    : hasher(sketch.active().hasher), t_b(t_b), t_e(t_e) {
+    std::vector<int> entries;
+    collectRowEdges(sketch.aging(), t_b, t_e, entries);
+    collectRowEdges(sketch.active(), t_b, t_e, entries);
+    buildRowIndex(*this, sketch.active().size(), entries);
+}
+
+// Expand one BFS level of `frontier` over the given CSR side. Returns true when a newly
+// reached row is already marked by the opposite search.
+static bool expandLevel(const std::vector<int>& start, const std::vector<int>& rows, std::vector<int>& frontier,
+                        DenseBitset& visited, const DenseBitset& other) {
+    std::vector<int> next;
+    for (std::size_t f = 0; f < frontier.size(); ++f) {
+        int r = frontier[f];
+        for (int e = start[r]; e < start[r + 1]; ++e) {
+            int reached = rows[e];
+            if (other.test(reached)) {
+                return true;
+            }
+            if (!visited.test(reached)) {
+                visited.set(reached);
+                next.push_back(reached);
+            }
+        }
+    }
+    frontier.swap(next);
+    return false;
+}
+
+bool reachabilityQuery(const ReachabilitySnapshot& snapshot, std::pair<int, int> startEndPair) {
+    int n = snapshot.size();
+    DenseBitset forward(n), backward(n);
+    std::vector<int> forwardFrontier, backwardFrontier;
+
+    int source = snapshot.hasher.row(startEndPair.first);
+    forward.set(source);
+    forwardFrontier.push_back(source);
+
+    // The backward search starts from the home rows of the edges into dst itself
+    int target = snapshot.hasher.row(startEndPair.second);
+    for (int e = snapshot.inStart[target]; e < snapshot.inStart[target + 1]; ++e) {
+        int home = snapshot.inRow[e];
+        if (snapshot.inVertex[e] != startEndPair.second || backward.test(home)) {
+            continue;
+        }
+        if (home == source) {
+            return true;
+        }
+        backward.set(home);
+        backwardFrontier.push_back(home);
+    }
+
+    // Always grow the smaller side
+    while (!forwardFrontier.empty() && !backwardFrontier.empty()) {
+        bool met = forwardFrontier.size() <= backwardFrontier.size()
+            ? expandLevel(snapshot.outStart, snapshot.outRow, forwardFrontier, forward, backward)
+            : expandLevel(snapshot.inStart, snapshot.inRow, backwardFrontier, backward, forward);
+        if (met) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<bool> reachableTargets(const ReachabilitySnapshot& snapshot, int source, const std::vector<int>& targets) {
+    std::vector<bool> result(targets.size(), false);
+    std::unordered_map<int, std::vector<int>> pending;
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        pending[targets[i]].push_back(static_cast<int>(i));
+    }
+
+    DenseBitset visited(snapshot.size());
+    std::vector<int> frontier;
+    int start = snapshot.hasher.row(source);
+    visited.set(start);
+    frontier.push_back(start);
+
+    // Stop as soon as every distinct target has been seen as an edge destination
+    for (std::size_t head = 0; head < frontier.size() && !pending.empty(); ++head) {
+        int r = frontier[head];
+        for (int e = snapshot.outStart[r]; e < snapshot.outStart[r + 1]; ++e) {
+            std::unordered_map<int, std::vector<int>>::iterator it = pending.find(snapshot.outVertex[e]);
+            if (it != pending.end()) {
+                for (std::size_t i = 0; i < it->second.size(); ++i) {
+                    result[it->second[i]] = true;
+                }
+                pending.erase(it);
+            }
+            int next = snapshot.outRow[e];
+            if (!visited.test(next)) {
+                visited.set(next);
+                frontier.push_back(next);
+            }
+        }
+    }
+    return result;
+}
+
+template <typename Sketch>
+static std::vector<bool> batchReachable(const Sketch& sketch, const std::vector<PathQuery>& queries) {
+    std::vector<bool> result(queries.size(), false);
+    std::vector<int> order(queries.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        const PathQuery& x = queries[a];
+        const PathQuery& y = queries[b];
+        if (x.t_b != y.t_b) return x.t_b < y.t_b;
+        if (x.t_e != y.t_e) return x.t_e < y.t_e;
+        return x.sd.first < y.sd.first;
+    });
+
+    std::size_t i = 0;
+    while (i < order.size()) {
+        const PathQuery& first = queries[order[i]];
+        std::size_t end = i + 1;
+        while (end < order.size() && queries[order[end]].t_b == first.t_b && queries[order[end]].t_e == first.t_e) {
+            ++end;
+        }
+        if (end - i == 1) {
+            // Nothing to share: a snapshot would cost more than the search it serves
+            result[order[i]] = reachabilityQuery(sketch, first.sd, first.t_b, first.t_e);
+            ++i;
+            continue;
+        }
+        ReachabilitySnapshot snapshot(sketch, first.t_b, first.t_e);
+
+        // All queries over this window, split into runs that share a source
+        while (i < end) {
+            std::size_t j = i;
+            int source = queries[order[i]].sd.first;
+            while (j < end && queries[order[j]].sd.first == source) {
+                ++j;
+            }
+
+            if (j - i == 1) {
+                result[order[i]] = reachabilityQuery(snapshot, queries[order[i]].sd);
+            } else {
+                std::vector<int> targets;
+                for (std::size_t q = i; q < j; ++q) {
+                    targets.push_back(queries[order[q]].sd.second);
+                }
+                std::vector<bool> reached = reachableTargets(snapshot, source, targets);
+                for (std::size_t q = i; q < j; ++q) {
+                    result[order[q]] = reached[q - i];
+                }
+            }
+            i = j;
+        }
+    }
+    return result;
+}
+
+std::vector<bool> batchReachabilityQuery(const WorkingMatrix& matrix, const std::vector<PathQuery>& queries) {
+    return batchReachable(matrix, queries);
+}
+
+std::vector<bool> batchReachabilityQuery(const GeminiSketch& sketch, const std::vector<PathQuery>& queries) {
+    return batchReachable(sketch, queries);
+}
 
+int subgraphQuery(const GeminiSketch& sketch, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit) {
+    return subgraphWeight(sketch, subgraph, t_b, t_e, earlyExit);
 }
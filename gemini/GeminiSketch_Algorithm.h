@@ -4,8 +4,106 @@
 #include <iostream>
 #include <vector>
 #include <utility>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <climits>
+#include <new>
+#include <algorithm>
 #include <xxhash.h>
 
+// Cache line size used to align the matrix storage
+const std::size_t CACHE_LINE_SIZE = 64;
+
+// Heap accounting for the sketch storage. The matrix arrays and the edge rings take
+// their memory through trackedAllocate/trackedRelease, which keep process-wide totals
+// of the bytes asked for and the bytes the allocator actually reserved for them.
+struct HeapStats {
+    std::size_t requestedBytes; // live bytes asked for
+    std::size_t reservedBytes; // live bytes held by the allocator, headers and rounding included
+    std::size_t allocations; // blocks allocated so far
+    std::size_t liveBlocks; // blocks not yet released
+};
+
+// Allocate bytes (aligned to `alignment` if non-zero); throws std::bad_alloc on failure
+void* trackedAllocate(std::size_t bytes, std::size_t alignment = 0);
+// Release a block from trackedAllocate of the given size
+void trackedRelease(void* p, std::size_t bytes);
+HeapStats heapStats();
+// Bytes the allocator holds for the block at p, its header included (0 for nullptr)
+std::size_t reservedBytes(const void* p);
+// Resident set size of the process, from /proc/self/statm (0 where unavailable)
+std::size_t residentBytes();
+
+// Fixed-size array held in a single cache-line-aligned allocation
+template <typename T>
+class AlignedArray {
+public:
+    AlignedArray() : data_(nullptr), size_(0) {}
+
+    explicit AlignedArray(std::size_t size) : data_(nullptr), size_(0) {
+        if (size > 0) {
+            data_ = static_cast<T*>(trackedAllocate(size * sizeof(T), CACHE_LINE_SIZE));
+        }
+        for (; size_ < size; ++size_) {
+            new (&data_[size_]) T();
+        }
+    }
+
+    AlignedArray(AlignedArray&& other) : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    AlignedArray& operator=(AlignedArray&& other) {
+        if (this != &other) {
+            release();
+            data_ = other.data_;
+            size_ = other.size_;
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    ~AlignedArray() { release(); }
+
+    T& operator[](std::size_t i) { return data_[i]; }
+    const T& operator[](std::size_t i) const { return data_[i]; }
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    AlignedArray(const AlignedArray&);
+    AlignedArray& operator=(const AlignedArray&);
+
+    void release() {
+        for (std::size_t i = 0; i < size_; ++i) {
+            data_[i].~T();
+        }
+        trackedRelease(data_, size_ * sizeof(T));
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    T* data_;
+    std::size_t size_;
+};
+
+// Fixed-size bit set, one bit per matrix row
+class DenseBitset {
+public:
+    explicit DenseBitset(std::size_t bits = 0) : words_((bits + 63) / 64, 0) {}
+
+    bool test(std::size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1ULL; }
+    void set(std::size_t i) { words_[i >> 6] |= 1ULL << (i & 63); }
+    void clear() { words_.assign(words_.size(), 0); }
+
+private:
+    std::vector<unsigned long long> words_;
+};
+
 // Define the edge structure
 struct Edge {
     std::pair<int, int> sd; // <s, d>
@@ -14,30 +112,367 @@ struct Edge {
     Edge(std::pair<int, int> sd, int weight, int time) : sd(sd), weight(weight), time(time) {}
 };
 
+// Round x up to the next power of two
+inline int nextPowerOfTwo(int x) {
+    int p = 1;
+    while (p < x) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Count and total weight of the entries of parallel time/weight columns with time
+// in [t_b, t_e]. Uses AVX2 when the CPU has it (checked once at runtime), else scalar.
+void rangeCountSum(const int* time, const int* weight, std::size_t n, int t_b, int t_e,
+                   int& count, long long& sum);
+
+// Rings up to this size answer range queries with a linear rangeCountSum scan,
+// larger ones with binary search and the prefix sums
+const std::size_t RING_SCAN_THRESHOLD = 32;
+
+// Growable ring buffer holding the edges of a bucket in time order
+// Edges are appended at the back and expire from the front, both in O(1).
+// All edges of a bucket share one <s, d>, so the ring stores it once and keeps
+// the rest as columns: time, weight and a running prefix sum of the weights.
+// Small rings are scanned with rangeCountSum, large ones take two binary searches.
+class EdgeRing {
+public:
+    // Walks the slots directly: the slot advances with the index, wrapping at cap
+    class const_iterator {
+    public:
+        const_iterator(const EdgeRing* ring, std::size_t i) : ring_(ring), i_(i), slot_(i < ring->size_ ? ring->slot(i) : 0) {}
+        Edge operator*() const { return Edge(ring_->sd_, ring_->weights()[slot_], ring_->times()[slot_]); }
+        const_iterator& operator++() {
+            ++i_;
+            slot_ = (slot_ + 1) & (ring_->cap_ - 1);
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const { return i_ == other.i_; }
+        bool operator!=(const const_iterator& other) const { return i_ != other.i_; }
+    private:
+        const EdgeRing* ring_;
+        std::size_t i_;
+        std::size_t slot_;
+    };
+
+    EdgeRing() : cw_(nullptr), head_(0), size_(0), cap_(0), sd_(0, 0) {}
+    ~EdgeRing() { trackedRelease(cw_, cap_ * slotBytes()); }
+
+    bool empty() const { return size_ == 0; }
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return cap_; }
+    // The block holding the columns (nullptr until the first edge)
+    const void* storage() const { return cw_; }
+
+    // Bytes of column storage per slot
+    static std::size_t slotBytes() { return sizeof(long long) + 2 * sizeof(int); }
+
+    Edge operator[](std::size_t i) const {
+        std::size_t k = slot(i);
+        return Edge(sd_, weights()[k], times()[k]);
+    }
+    Edge front() const { return (*this)[0]; }
+    Edge back() const { return (*this)[size_ - 1]; }
+    int time(std::size_t i) const { return times()[slot(i)]; }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size_); }
+
+    // Append e, keeping the edges sorted by time
+    // A late edge is moved back into place, which costs its distance from the back.
+    void push_back(const Edge& e) {
+        if (size_ == cap_) {
+            grow();
+        }
+        sd_ = e.sd;
+        int* t = times();
+        int* w = weights();
+        long long base = weightBefore(0);
+        std::size_t i = size_;
+        while (i > 0 && t[slot(i - 1)] > e.time) {
+            t[slot(i)] = t[slot(i - 1)];
+            w[slot(i)] = w[slot(i - 1)];
+            --i;
+        }
+        t[slot(i)] = e.time;
+        w[slot(i)] = e.weight;
+        ++size_;
+        long long running = i == 0 ? base : cw_[slot(i - 1)];
+        for (; i < size_; ++i) {
+            running += w[slot(i)];
+            cw_[slot(i)] = running;
+        }
+    }
+
+    void pop_front() {
+        head_ = (head_ + 1) & (cap_ - 1);
+        --size_;
+    }
+
+    // Replace the contents with a copy of other's, reusing the storage when it fits
+    void assign(const EdgeRing& other) {
+        if (cap_ < other.size_) {
+            trackedRelease(cw_, cap_ * slotBytes());
+            cap_ = static_cast<std::size_t>(nextPowerOfTwo(static_cast<int>(other.size_)));
+            cw_ = static_cast<long long*>(trackedAllocate(cap_ * slotBytes()));
+        }
+        for (std::size_t i = 0; i < other.size_; ++i) {
+            cw_[i] = other.cw_[other.slot(i)];
+            times()[i] = other.times()[other.slot(i)];
+            weights()[i] = other.weights()[other.slot(i)];
+        }
+        head_ = 0;
+        size_ = other.size_;
+        sd_ = other.sd_;
+    }
+
+    // Drop all edges but keep the storage for reuse
+    void clear() {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    // Index of the first edge with time >= t
+    std::size_t lowerBound(int t) const {
+        if (size_ <= RING_SCAN_THRESHOLD) {
+            // Sorted, so the index is the number of edges before t
+            return t == INT_MIN ? 0 : static_cast<std::size_t>(scan(INT_MIN, t - 1).first);
+        }
+        std::size_t lo = 0, hi = size_;
+        while (lo < hi) {
+            std::size_t mid = (lo + hi) / 2;
+            if (time(mid) < t) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // Index of the first edge with time > t
+    std::size_t upperBound(int t) const { return t == INT_MAX ? size_ : lowerBound(t + 1); }
+
+    // Total weight of the edges with index in [lo, hi)
+    long long weightBetween(std::size_t lo, std::size_t hi) const {
+        return lo >= hi ? 0 : weightBefore(hi) - weightBefore(lo);
+    }
+
+    // Number and total weight of the edges with time in [t_b, t_e]
+    int countInRange(int t_b, int t_e) const {
+        if (t_b > t_e) {
+            return 0;
+        }
+        if (size_ <= RING_SCAN_THRESHOLD) {
+            return scan(t_b, t_e).first;
+        }
+        return static_cast<int>(upperBound(t_e) - lowerBound(t_b));
+    }
+    long long weightInRange(int t_b, int t_e) const {
+        if (t_b > t_e) {
+            return 0;
+        }
+        if (size_ <= RING_SCAN_THRESHOLD) {
+            return scan(t_b, t_e).second;
+        }
+        return weightBetween(lowerBound(t_b), upperBound(t_e));
+    }
+
+    // Call visit(edge) for every edge with time in [t_b, t_e]
+    // The columns are walked in their one or two contiguous runs, as scan() does, and
+    // an Edge is only built for the edges in range. Large rings start at lowerBound(t_b).
+    template <typename Visitor>
+    void forEachInRange(int t_b, int t_e, Visitor& visit) const {
+        if (t_b > t_e || size_ == 0) {
+            return;
+        }
+        std::size_t lo = size_ <= RING_SCAN_THRESHOLD ? 0 : lowerBound(t_b);
+        std::size_t start = slot(lo);
+        std::size_t first = std::min(size_ - lo, cap_ - start);
+        if (visitRun(start, first, t_b, t_e, visit)) {
+            visitRun(0, size_ - lo - first, t_b, t_e, visit);
+        }
+    }
+
+private:
+    EdgeRing(const EdgeRing&);
+    EdgeRing& operator=(const EdgeRing&);
+
+    std::size_t slot(std::size_t i) const { return (head_ + i) & (cap_ - 1); }
+
+    // The three columns share one block: cw_[cap], then times[cap], then weights[cap]
+    int* times() const { return reinterpret_cast<int*>(cw_ + cap_); }
+    int* weights() const { return times() + cap_; }
+
+    // rangeCountSum over the live slots, which wrap into at most two runs
+    std::pair<int, long long> scan(int t_b, int t_e) const {
+        int count = 0;
+        long long sum = 0;
+        std::size_t first = std::min(size_, cap_ - head_);
+        if (first > 0) {
+            rangeCountSum(times() + head_, weights() + head_, first, t_b, t_e, count, sum);
+        }
+        if (size_ > first) {
+            int c = 0;
+            long long w = 0;
+            rangeCountSum(times(), weights(), size_ - first, t_b, t_e, c, w);
+            count += c;
+            sum += w;
+        }
+        return std::make_pair(count, sum);
+    }
+
+    // Visit the in-range edges of slots [start, start + n); false once past t_e
+    template <typename Visitor>
+    bool visitRun(std::size_t start, std::size_t n, int t_b, int t_e, Visitor& visit) const {
+        const int* t = times();
+        const int* w = weights();
+        for (std::size_t k = start; k < start + n; ++k) {
+            if (t[k] > t_e) {
+                return false;
+            }
+            if (t[k] >= t_b) {
+                visit(Edge(sd_, w[k], t[k]));
+            }
+        }
+        return true;
+    }
+
+    // Running weight of the edges before index i (prefix sums are kept absolute,
+    // so popping from the front does not touch them)
+    long long weightBefore(std::size_t i) const {
+        if (i == 0) {
+            return size_ == 0 ? 0 : cw_[head_] - weights()[head_];
+        }
+        return cw_[slot(i - 1)];
+    }
+
+    // Double the capacity (kept a power of two) and unwrap the edges to the front
+    void grow() {
+        std::size_t cap = cap_ == 0 ? 2 : cap_ * 2;
+        long long* cw = static_cast<long long*>(trackedAllocate(cap * slotBytes()));
+        int* t = reinterpret_cast<int*>(cw + cap);
+        int* w = t + cap;
+        for (std::size_t i = 0; i < size_; ++i) {
+            cw[i] = cw_[slot(i)];
+            t[i] = times()[slot(i)];
+            w[i] = weights()[slot(i)];
+        }
+        trackedRelease(cw_, cap_ * slotBytes());
+        cw_ = cw;
+        head_ = 0;
+        cap_ = cap;
+    }
+
+    long long* cw_; // cw_[slot(i)]: running weight up to and including edge i
+    std::size_t head_;
+    std::size_t size_;
+    std::size_t cap_;
+    std::pair<int, int> sd_; // <s, d> shared by every edge of the bucket
+};
+
 // Define the bucket structure
+// Only the hot metadata lives here; the edge list of a bucket is kept in the
+// parallel cold array WorkingMatrix::L so that row and matrix scans stay dense.
 struct Bucket {
     std::pair<int, int> vx; // <s, d>
     int ec; // edge count
-    int CF; // flag
-    std::vector<Edge> list; // edge list
-    int GT; // timestamp
-    Bucket* bqp; // bucket queue pointer
-    Bucket() : ec(0), CF(0), GT(0), bqp(nullptr) {}
+    int CF; // chain flag: 0 if free, otherwise 1 + offset from the home row
+    int GT; // timestamp of the newest edge
+    int FT; // timestamp of the oldest edge
+    int bqp; // bucket queue pointer (index of the next bucket, -1 if none)
+    int bqb; // bucket queue back pointer (index of the previous bucket, -1 if none)
+    Bucket() : vx(0, 0), ec(0), CF(0), GT(0), FT(0), bqp(-1), bqb(-1) {}
+};
+
+// Define the vertex hasher of a matrix
+// Hashes are bound to the matrix dimension with a multiply-shift range reduction
+// ((h * n) >> 32), so any dimension works, not only powers of two.
+// Sources (rows) and destinations (columns) are hashed with independent seeds.
+struct Hasher {
+    std::uint64_t n; // matrix dimension
+    unsigned rowSeed; // seed for source vertices
+    unsigned colSeed; // seed for destination vertices
+    Hasher(int size, unsigned seed)
+        : n(static_cast<std::uint64_t>(size)), rowSeed(seed), colSeed(XXH32(&seed, sizeof(seed), 0x9E3779B9u)) {}
+
+    int row(int v) const { return reduce(XXH32(&v, sizeof(v), rowSeed)); }
+    int col(int v) const { return reduce(XXH32(&v, sizeof(v), colSeed)); }
+    int reduce(std::uint32_t h) const { return static_cast<int>((h * n) >> 32); }
 };
 
 // Define the working matrix structure
+// Buckets are stored row-major in one contiguous block: bucket (i, j) is G[i * n + j].
 struct WorkingMatrix {
-    std::vector<std::vector<Bucket>> G; // matrix
+    int n; // matrix dimension
+    Hasher hasher; // vertex hasher bound to n
+    int g; // hash chain length: rows probed after the home row
+    long long overflow; // edges dropped because their whole chain was taken
+    AlignedArray<Bucket> G; // matrix (hot bucket metadata)
+    AlignedArray<EdgeRing> L; // edge lists (cold payload), parallel to G
     int WS; // working status
-    Bucket* HP; // head pointer
-    Bucket* MP; // middle pointer
-    Bucket* TP; // tail pointer
-    WorkingMatrix(int size) : WS(0), HP(nullptr), MP(nullptr), TP(nullptr) {
-        G.resize(size, std::vector<Bucket>(size));
+    // Virtual bucket queue: occupied buckets in the order they were claimed
+    int HP; // head pointer (bucket index, -1 if the queue is empty)
+    int MP; // middle pointer: where the next rolling-out step resumes (-1 = at HP)
+    int TP; // tail pointer
+    WorkingMatrix(int size, unsigned seed = 0, int chainLength = 1)
+        : n(size), hasher(n, seed), g(chainLength < n ? chainLength : n - 1), overflow(0),
+          G(static_cast<std::size_t>(n) * n), L(static_cast<std::size_t>(n) * n),
+          WS(0), HP(-1), MP(-1), TP(-1) {}
+
+    int size() const { return n; }
+    std::size_t cells() const { return G.size(); }
+    std::size_t index(int i, int j) const { return static_cast<std::size_t>(i) * n + j; }
+
+    Bucket* row(int i) { return &G[index(i, 0)]; }
+    const Bucket* row(int i) const { return &G[index(i, 0)]; }
+    // Row of the offset-th bucket on the chain starting at row i
+    // (offset <= g < n, so one wrap is enough)
+    int probe(int i, int offset) const { return i + offset < n ? i + offset : i + offset - n; }
+    Bucket& bucket(int i, int j) { return G[index(i, j)]; }
+    const Bucket& bucket(int i, int j) const { return G[index(i, j)]; }
+    EdgeRing& list(std::size_t k) { return L[k]; }
+    const EdgeRing& list(std::size_t k) const { return L[k]; }
+};
+
+// Define the Gemini sketch: two working matrices that take turns
+// The active matrix (WS = 1) receives the edges of the current period of length T,
+// the aging matrix (WS = 0) keeps the previous period. When an edge of the next
+// period arrives, everything in the aging matrix is older than the window, so it
+// is cleared in one pass over its bucket queue and becomes the active matrix.
+// Queries merge both matrices.
+struct GeminiSketch {
+    WorkingMatrix M0;
+    WorkingMatrix M1;
+    int T; // period length (expiration threshold)
+    int start; // first timestamp of the active period
+    bool started; // false until the first edge sets start
+    GeminiSketch(int size, int T, unsigned seed = 0, int chainLength = 1)
+        : M0(size, seed, chainLength), M1(size, seed, chainLength), T(T), start(0), started(false) {
+        M0.WS = 1;
     }
+
+    WorkingMatrix& active() { return M0.WS ? M0 : M1; }
+    const WorkingMatrix& active() const { return M0.WS ? M0 : M1; }
+    WorkingMatrix& aging() { return M0.WS ? M1 : M0; }
+    const WorkingMatrix& aging() const { return M0.WS ? M1 : M0; }
 };
 
-int H(int x);
+// Largest matrix dimension whose buckets fit in the given number of bytes
+int matrixSizeForBudget(std::size_t bytes);
+
+// Memory held by a matrix or sketch, block by block as the allocator sees it. Live
+// bytes are the matrix structure and the ring slots holding edges; the rest of the
+// reserved bytes is spare ring capacity and allocator overhead.
+struct MemoryStats {
+    std::size_t reservedBytes;
+    std::size_t liveBytes;
+    std::size_t allocations; // heap blocks
+    // Share of the reserved bytes that hold no live data
+    double fragmentation() const { return reservedBytes > 0 ? 1.0 - static_cast<double>(liveBytes) / reservedBytes : 0; }
+};
+
+MemoryStats memoryStats(const WorkingMatrix& matrix);
+MemoryStats memoryStats(const GeminiSketch& sketch);
 
 // Vertex query algorithm
 bool vertexQuery(const WorkingMatrix& matrix, int v, int t_b, int t_e);
@@ -49,20 +484,209 @@ int totalOutgoingWeight(const WorkingMatrix& matrix, int v, int t_b, int t_e);
 int outgoingEdgeCount(const WorkingMatrix& matrix, int v, int t_b, int t_e);
 
 // Insertion operation
-void insertion(WorkingMatrix& matrix, Edge e);
+// Edge <s, d> goes to the first bucket on the chain (H(s) + k, H(d)), k = 0..g, that
+// already holds <s, d> or is free. If the whole chain is taken the edge is dropped
+// and counted in matrix.overflow, so an insertion touches at most g + 1 buckets.
+// Returns the index of the bucket that took the edge, -1 if it was dropped.
+int insertion(WorkingMatrix& matrix, Edge e);
+
+// Batched insertion: edges are hashed INSERT_BATCH_BLOCK at a time and their home
+// buckets prefetched before the inserts are applied. Same result as inserting in order.
+const std::size_t INSERT_BATCH_BLOCK = 64;
+void insertBatch(WorkingMatrix& matrix, const Edge* edges, std::size_t count);
+void insertBatch(WorkingMatrix& matrix, const std::vector<Edge>& edges);
+
+// Index of the bucket holding edge <s, d> on its hash chain, -1 if there is none
+// Looks at the g + 1 buckets (H(s) + k, H(d)) only.
+int findBucket(const WorkingMatrix& matrix, std::pair<int, int> sd);
+
+// Unlink bucket k from the virtual bucket queue and reset it to free
+void releaseBucket(WorkingMatrix& matrix, int k);
+
+// Drop the edges of bucket k with time <= Te, releasing the bucket once it is empty
+// Returns true if the bucket was released.
+bool expireBucket(WorkingMatrix& matrix, int k, int Te);
 
-// Eliminate expired edges operation
-void eliminateExpiredEdges(WorkingMatrix& matrix, int Te);
+// Eliminate expired edges operation (rolling-out over the virtual bucket queue)
+// Visits at most budget buckets, starting at MP and wrapping around at the tail,
+// and drops their edges with time <= Te; buckets left empty are released. A
+// negative budget walks the whole queue once. Calling it with a small budget on
+// every insertion spreads expiration evenly over the stream.
+void eliminateExpiredEdges(WorkingMatrix& matrix, int Te, int budget = -1);
+
+// Reset every bucket on the bucket queue, leaving an empty matrix
+// Costs one step per occupied bucket, independent of the number of edges.
+void clearMatrix(WorkingMatrix& matrix);
+
+// Make `to` an exact copy of `from` (same size), reusing to's edge storage
+void copyMatrix(const WorkingMatrix& from, WorkingMatrix& to);
+
+// Gemini sketch operations: insertion switches matrices when a new period starts
+// and returns the bucket of the active matrix that took the edge (-1 if dropped)
+int insertion(GeminiSketch& sketch, Edge e);
+void insertBatch(GeminiSketch& sketch, const Edge* edges, std::size_t count);
+void insertBatch(GeminiSketch& sketch, const std::vector<Edge>& edges);
+void switchMatrices(GeminiSketch& sketch);
+void copySketch(const GeminiSketch& from, GeminiSketch& to);
+bool vertexQuery(const GeminiSketch& sketch, int v, int t_b, int t_e);
+int totalOutgoingWeight(const GeminiSketch& sketch, int v, int t_b, int t_e);
+int outgoingEdgeCount(const GeminiSketch& sketch, int v, int t_b, int t_e);
+std::vector<Edge> findActiveEdges(const GeminiSketch& sketch, int t_b, int t_e);
+bool checkVertexRelationship(const GeminiSketch& sketch, std::pair<int, int> vertexPair, int t_b, int t_e);
+bool reachabilityQuery(const GeminiSketch& sketch, std::pair<int, int> startEndPair, int t_b, int t_e);
+int subgraphQuery(const GeminiSketch& sketch, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit = true);
 
 // Time-related query: Find all active edges within [t_b, t_e]
 std::vector<Edge> findActiveEdges(const WorkingMatrix& matrix, int t_b, int t_e);
 
+// Scanning queries gather the buckets that match QUERY_PREFETCH_BLOCK at a time from
+// the hot bucket metadata and prefetch their edge rings before reading any, so the
+// cache misses on the scattered rings overlap instead of being taken one by one
+const std::size_t QUERY_PREFETCH_BLOCK = 64;
+
+// Hint the cache that the edge ring of bucket k is about to be read
+inline void prefetchRing(const WorkingMatrix& matrix, std::size_t k) {
+#if defined(__GNUC__)
+    __builtin_prefetch(&matrix.L[k]);
+#else
+    (void)matrix;
+    (void)k;
+#endif
+}
+
+// Hint the cache that the columns of bucket k's edge ring are about to be read
+inline void prefetchColumns(const WorkingMatrix& matrix, std::size_t k) {
+#if defined(__GNUC__)
+    __builtin_prefetch(matrix.list(k).storage());
+#else
+    (void)matrix;
+    (void)k;
+#endif
+}
+
+// Call visit(edge) for every edge of bucket k with time in [t_b, t_e]
+// Buckets whose [FT, GT] span misses the range are skipped without touching their list.
+template <typename Visitor>
+inline void forEachBucketEdge(const WorkingMatrix& matrix, std::size_t k, int t_b, int t_e, Visitor& visit) {
+    const Bucket& bucket = matrix.G[k];
+    if (bucket.CF == 0 || bucket.GT < t_b || bucket.FT > t_e) {
+        return;
+    }
+    matrix.list(k).forEachInRange(t_b, t_e, visit);
+}
+
+// True if bucket k holds at least one edge within [t_b, t_e]
+inline bool bucketInRange(const WorkingMatrix& matrix, std::size_t k, int t_b, int t_e) {
+    const Bucket& bucket = matrix.G[k];
+    return bucket.CF != 0 && bucket.GT >= t_b && bucket.FT <= t_e &&
+           matrix.list(k).countInRange(t_b, t_e) > 0;
+}
+
+// Streaming form of findActiveEdges: visit every active edge in place, no copies
+template <typename Visitor>
+void forEachActiveEdge(const WorkingMatrix& matrix, int t_b, int t_e, Visitor&& visit) {
+    std::size_t matches[QUERY_PREFETCH_BLOCK];
+    std::size_t k = 0;
+    while (k < matrix.cells()) {
+        std::size_t count = 0;
+        for (; k < matrix.cells() && count < QUERY_PREFETCH_BLOCK; ++k) {
+            const Bucket& bucket = matrix.G[k];
+            if (bucket.CF != 0 && bucket.GT >= t_b && bucket.FT <= t_e) {
+                matches[count++] = k;
+            }
+        }
+        for (std::size_t m = 0; m < count; ++m) {
+            prefetchColumns(matrix, matches[m]);
+        }
+        for (std::size_t m = 0; m < count; ++m) {
+            matrix.list(matches[m]).forEachInRange(t_b, t_e, visit);
+        }
+    }
+}
+
+// Visit the outgoing edges of v within [t_b, t_e] (the rows of v's hash chain only)
+template <typename Visitor>
+void forEachOutgoingEdge(const WorkingMatrix& matrix, int v, int t_b, int t_e, Visitor&& visit) {
+    int r = matrix.hasher.row(v);
+    for (int offset = 0; offset <= matrix.g; ++offset) {
+        int adjusted_r = matrix.probe(r, offset);
+        const Bucket* row = matrix.row(adjusted_r);
+        for (int j = 0; j < matrix.size(); ++j) {
+            if (row[j].vx.first == v) {
+                forEachBucketEdge(matrix, matrix.index(adjusted_r, j), t_b, t_e, visit);
+            }
+        }
+    }
+}
+
+// Gemini sketch forms: the aging matrix is visited first, then the active one
+template <typename Visitor>
+void forEachActiveEdge(const GeminiSketch& sketch, int t_b, int t_e, Visitor&& visit) {
+    forEachActiveEdge(sketch.aging(), t_b, t_e, visit);
+    forEachActiveEdge(sketch.active(), t_b, t_e, visit);
+}
+
+template <typename Visitor>
+void forEachOutgoingEdge(const GeminiSketch& sketch, int v, int t_b, int t_e, Visitor&& visit) {
+    forEachOutgoingEdge(sketch.aging(), v, t_b, t_e, visit);
+    forEachOutgoingEdge(sketch.active(), v, t_b, t_e, visit);
+}
+
 // Time-related query: Check the relationship between vertices within [t_b, t_e]
 bool checkVertexRelationship(const WorkingMatrix& matrix, std::pair<int, int> vertexPair, int t_b, int t_e);
 
-// Reachability query
 // Calculate the average hash chain length
 float averageHashChainLength(const WorkingMatrix& matrix);
+
+// Reachability query: breadth-first search over matrix rows, where row H(s) stands
+// for s and its out-neighbours are the columns of the buckets homed in that row.
+// Vertices sharing a row are merged, so collisions can only add paths.
 bool reachabilityQuery(const WorkingMatrix& matrix, std::pair<int, int> startEndPair, int t_b, int t_e);
 
-#endif
\ No newline at end of file
+// Subgraph query: total in-range weight of the subgraph edges within [t_b, t_e], each
+// resolved by a direct bucket lookup. With earlyExit the lookups stop at the first
+// missing edge and -1 is returned; without it the weight of the edges found is returned.
+// Subgraphs of PARALLEL_SUBGRAPH_EDGES or more edges are split across worker threads.
+const std::size_t PARALLEL_SUBGRAPH_EDGES = 4096;
+int subgraphQuery(const WorkingMatrix& matrix, const std::vector<Edge>& subgraph, int t_b, int t_e, bool earlyExit = true);
+
+// Row-level adjacency of the graph active in one window [t_b, t_e], in CSR form.
+// Built once and shared by every reachability query over that window.
+struct ReachabilitySnapshot {
+    Hasher hasher;
+    int t_b;
+    int t_e;
+    std::vector<int> outStart; // row r's out-entries are [outStart[r], outStart[r + 1])
+    std::vector<int> outRow; // H(d) of each out-entry
+    std::vector<int> outVertex; // d of each out-entry
+    std::vector<int> inStart; // row r's in-entries are [inStart[r], inStart[r + 1])
+    std::vector<int> inRow; // home row H(s) of each in-entry
+    std::vector<int> inVertex; // d of each in-entry
+
+    ReachabilitySnapshot(const WorkingMatrix& matrix, int t_b, int t_e);
+    ReachabilitySnapshot(const GeminiSketch& sketch, int t_b, int t_e);
+
+    int size() const { return static_cast<int>(outStart.size()) - 1; }
+};
+
+// Bidirectional search for one pair, same answers as reachabilityQuery
+bool reachabilityQuery(const ReachabilitySnapshot& snapshot, std::pair<int, int> startEndPair);
+
+// One forward traversal from source answering every target; result[i] is for targets[i]
+std::vector<bool> reachableTargets(const ReachabilitySnapshot& snapshot, int source, const std::vector<int>& targets);
+
+// A path query <s, d> over [t_b, t_e]
+struct PathQuery {
+    std::pair<int, int> sd;
+    int t_b;
+    int t_e;
+    PathQuery(std::pair<int, int> sd, int t_b, int t_e) : sd(sd), t_b(t_b), t_e(t_e) {}
+};
+
+// Batch reachability: queries are grouped by window (one snapshot each) and then by
+// source; lone pairs use the bidirectional search, shared sources one traversal.
+// A window with a single query is answered on the sketch, without a snapshot.
+std::vector<bool> batchReachabilityQuery(const WorkingMatrix& matrix, const std::vector<PathQuery>& queries);
+std::vector<bool> batchReachabilityQuery(const GeminiSketch& sketch, const std::vector<PathQuery>& queries);
+
+#endif
@@ -0,0 +1,258 @@
+#include "GeminiSketch_Algorithm.h"
+#include "Gemini  elimination.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using namespace std;
+
+// Microbenchmarks of the hot paths in isolation: hashing, insertion, every query
+// and the three elimination strategies, on working matrices of several sizes filled
+// to several bucket occupancies. Every benchmark runs one warm-up and REPETITIONS
+// timed repetitions of a fixed number of operations; the table reports the median,
+// min and max time per operation and the coefficient of variation across them.
+// Benchmarks that modify the matrix restore it from a filled copy before each
+// repetition, outside the timed section.
+
+const int MATRIX_SIZES[] = {256, 512, 1024};
+const double FILL_LEVELS[] = {0.1, 0.5, 0.9}; // fraction of buckets holding an edge
+const int HASH_CHAIN_LENGTH = 4;
+const int EDGES_PER_PAIR = 4; // edges per <s, d>, one time unit apart
+const int TIME_SPAN = 1000; // first edge times are drawn from [0, TIME_SPAN)
+const int SUBGRAPH_EDGES = 50;
+const int REPETITIONS = 7;
+
+struct Timing {
+    double median; // ns per operation
+    double min;
+    double max;
+    double cv; // standard deviation / mean
+};
+
+// Time `ops` operations of body per repetition; setup runs untimed before each one.
+// The checksum keeps the results live.
+template <typename Setup, typename Body>
+Timing measure(size_t ops, Setup setup, Body body, long long& checksum) {
+    vector<double> perOp;
+    for (int r = 0; r <= REPETITIONS; r++) {
+        setup();
+        auto start = chrono::steady_clock::now();
+        checksum += body();
+        auto end = chrono::steady_clock::now();
+        if (r > 0) {
+            perOp.push_back(chrono::duration<double, nano>(end - start).count() / ops);
+        }
+    }
+    sort(perOp.begin(), perOp.end());
+    double mean = 0;
+    for (double t : perOp) {
+        mean += t;
+    }
+    mean /= perOp.size();
+    double variance = 0;
+    for (double t : perOp) {
+        variance += (t - mean) * (t - mean);
+    }
+    variance /= perOp.size();
+    return {perOp[perOp.size() / 2], perOp.front(), perOp.back(), mean > 0 ? sqrt(variance) / mean : 0};
+}
+
+void report(int size, double fill, const string& name, const Timing& t) {
+    cout << setw(6) << size << setw(6) << fill << "  " << left << setw(26) << name << right << fixed << setprecision(1)
+         << setw(14) << t.median << setw(14) << t.min << setw(14) << t.max << setw(8) << t.cv * 100 << endl;
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+}
+
+// Fill a matrix with distinct pairs until the given share of buckets is taken; the
+// pairs stored are returned
+vector<pair<int, int>> fillMatrix(WorkingMatrix& matrix, double fill, int vertices, mt19937& gen) {
+    uniform_int_distribution<> vertexDist(0, vertices - 1);
+    uniform_int_distribution<> timeDist(0, TIME_SPAN - 1);
+    vector<pair<int, int>> pairs;
+    size_t target = (size_t)(fill * matrix.cells());
+    size_t taken = 0;
+    while (taken < target) {
+        pair<int, int> sd(vertexDist(gen), vertexDist(gen));
+        if (findBucket(matrix, sd) != -1) {
+            continue;
+        }
+        long long overflow = matrix.overflow;
+        int t = timeDist(gen);
+        for (int k = 0; k < EDGES_PER_PAIR; k++) {
+            insertion(matrix, Edge(sd, 1, t + k));
+        }
+        if (matrix.overflow == overflow) {
+            pairs.push_back(sd);
+            taken++;
+        } else if (matrix.overflow > (long long)(8 * target)) {
+            break; // chains are saturated below the target occupancy
+        }
+    }
+    return pairs;
+}
+
+void benchmarkMatrix(int size, double fill, long long& checksum) {
+    mt19937 gen(size * 31 + (int)(fill * 100));
+    int vertices = size * 4;
+    WorkingMatrix filled(size, 1, HASH_CHAIN_LENGTH);
+    vector<pair<int, int>> pairs = fillMatrix(filled, fill, vertices, gen);
+    WorkingMatrix matrix(size, 1, HASH_CHAIN_LENGTH);
+    copyMatrix(filled, matrix);
+
+    uniform_int_distribution<> vertexDist(0, vertices - 1);
+    uniform_int_distribution<> pairDist(0, (int)pairs.size() - 1);
+    uniform_int_distribution<> timeDist(0, TIME_SPAN - 1);
+    auto window = [&]() {
+        int t_b = timeDist(gen);
+        return make_pair(t_b, t_b + TIME_SPAN / 4);
+    };
+    auto none = []() {};
+    auto restore = [&]() { copyMatrix(filled, matrix); };
+
+    const size_t hashOps = 1000000;
+    vector<int> keys(hashOps);
+    for (auto& v : keys) {
+        v = vertexDist(gen);
+    }
+    report(size, fill, "H (row + col)", measure(hashOps, none, [&]() {
+        long long sum = 0;
+        for (int v : keys) {
+            sum += matrix.hasher.row(v) + matrix.hasher.col(v);
+        }
+        return sum;
+    }, checksum));
+
+    // Half the inserted edges extend stored pairs, half bring new ones
+    const size_t insertOps = 100000;
+    vector<Edge> inserts;
+    for (size_t i = 0; i < insertOps; i++) {
+        pair<int, int> sd = i % 2 == 0 ? pairs[pairDist(gen)] : make_pair(vertexDist(gen), vertexDist(gen));
+        inserts.emplace_back(sd, 1, TIME_SPAN + (int)(i / 64));
+    }
+    report(size, fill, "insertion", measure(insertOps, restore, [&]() {
+        for (const auto& e : inserts) {
+            insertion(matrix, e);
+        }
+        return matrix.overflow;
+    }, checksum));
+    restore();
+
+    // Query inputs drawn once, so every repetition asks the same questions
+    const size_t pointOps = 100000;
+    const size_t rowOps = 2000;
+    const size_t reachOps = 50;
+    const size_t subgraphOps = 2000;
+    vector<pair<int, int>> pointQueries, pointWindows, rowWindows, reachWindows;
+    vector<int> rowVertices;
+    vector<pair<int, int>> reachPairs;
+    for (size_t i = 0; i < pointOps; i++) {
+        pointQueries.push_back(i % 2 == 0 ? pairs[pairDist(gen)] : make_pair(vertexDist(gen), vertexDist(gen)));
+        pointWindows.push_back(window());
+    }
+    for (size_t i = 0; i < rowOps; i++) {
+        rowVertices.push_back(pairs[pairDist(gen)].first);
+        rowWindows.push_back(window());
+    }
+    for (size_t i = 0; i < reachOps; i++) {
+        reachPairs.push_back(make_pair(pairs[pairDist(gen)].first, pairs[pairDist(gen)].second));
+        reachWindows.push_back(window());
+    }
+    vector<vector<Edge>> subgraphs(subgraphOps);
+    for (auto& subgraph : subgraphs) {
+        for (int k = 0; k < SUBGRAPH_EDGES; k++) {
+            subgraph.emplace_back(pairs[pairDist(gen)], 1, 0);
+        }
+    }
+
+    report(size, fill, "vertexQuery", measure(rowOps, none, [&]() {
+        long long sum = 0;
+        for (size_t i = 0; i < rowOps; i++) {
+            sum += vertexQuery(matrix, rowVertices[i], rowWindows[i].first, rowWindows[i].second);
+        }
+        return sum;
+    }, checksum));
+    report(size, fill, "totalOutgoingWeight", measure(rowOps, none, [&]() {
+        long long sum = 0;
+        for (size_t i = 0; i < rowOps; i++) {
+            sum += totalOutgoingWeight(matrix, rowVertices[i], rowWindows[i].first, rowWindows[i].second);
+        }
+        return sum;
+    }, checksum));
+    report(size, fill, "outgoingEdgeCount", measure(rowOps, none, [&]() {
+        long long sum = 0;
+        for (size_t i = 0; i < rowOps; i++) {
+            sum += outgoingEdgeCount(matrix, rowVertices[i], rowWindows[i].first, rowWindows[i].second);
+        }
+        return sum;
+    }, checksum));
+    report(size, fill, "checkVertexRelationship", measure(pointOps, none, [&]() {
+        long long sum = 0;
+        for (size_t i = 0; i < pointOps; i++) {
+            sum += checkVertexRelationship(matrix, pointQueries[i], pointWindows[i].first, pointWindows[i].second);
+        }
+        return sum;
+    }, checksum));
+    pair<int, int> scanWindow = window();
+    report(size, fill, "findActiveEdges", measure(1, none, [&]() {
+        return (long long)findActiveEdges(matrix, scanWindow.first, scanWindow.second).size();
+    }, checksum));
+    report(size, fill, "reachabilityQuery", measure(reachOps, none, [&]() {
+        long long sum = 0;
+        for (size_t i = 0; i < reachOps; i++) {
+            sum += reachabilityQuery(matrix, reachPairs[i], reachWindows[i].first, reachWindows[i].second);
+        }
+        return sum;
+    }, checksum));
+    report(size, fill, "subgraphQuery (50 edges)", measure(subgraphOps, none, [&]() {
+        long long sum = 0;
+        for (size_t i = 0; i < subgraphOps; i++) {
+            sum += subgraphQuery(matrix, subgraphs[i], 0, TIME_SPAN, false);
+        }
+        return sum;
+    }, checksum));
+
+    // Elimination drops roughly the older half of the edges; the rolling-out and
+    // full-scan strategies sweep the whole matrix once per operation
+    int Te = TIME_SPAN / 2;
+    report(size, fill, "rollingOutElimination", measure(1, restore, [&]() {
+        rollingOutElimination(matrix, Te);
+        return (long long)matrix.HP;
+    }, checksum));
+    report(size, fill, "fullScanElimination", measure(1, restore, [&]() {
+        fullScanElimination(matrix, Te);
+        return (long long)matrix.HP;
+    }, checksum));
+    const size_t lazyOps = 100000;
+    vector<Edge> lazyEdges;
+    for (size_t i = 0; i < lazyOps; i++) {
+        lazyEdges.emplace_back(pairs[pairDist(gen)], 1, 0);
+    }
+    report(size, fill, "lazyElimination", measure(lazyOps, restore, [&]() {
+        for (const auto& e : lazyEdges) {
+            lazyElimination(matrix, e, Te);
+        }
+        return (long long)matrix.HP;
+    }, checksum));
+}
+
+int main() {
+    cout << "GeminiSketch microbenchmarks (chain length " << HASH_CHAIN_LENGTH << ", " << REPETITIONS
+         << " repetitions, ns per operation)" << endl;
+    cout << setw(6) << "size" << setw(6) << "fill" << "  " << left << setw(26) << "benchmark" << right << setw(14)
+         << "median" << setw(14) << "min" << setw(14) << "max" << setw(8) << "cv%" << endl;
+
+    long long checksum = 0;
+    for (int size : MATRIX_SIZES) {
+        for (double fill : FILL_LEVELS) {
+            benchmarkMatrix(size, fill, checksum);
+        }
+    }
+    cout << "checksum " << checksum << endl;
+    return 0;
+}
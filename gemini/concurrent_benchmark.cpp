@@ -0,0 +1,135 @@
+#include "Gemini concurrent.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+// Mixed read/write benchmark: one writer streams edges into a ConcurrentSketch
+// while reader threads query published snapshots. Reports the writer's insert
+// throughput, the readers' query throughput and their query latency, and the
+// writer's publish pauses (count, mean and longest, buckets copied per publish,
+// publishes deferred while readers pinned every snapshot) against the cost of
+// copying the whole sketch.
+
+const int MATRIX_SIZE = 256;
+const int HASH_CHAIN_LENGTH = 4;
+const int STREAM_EDGES = 2000000;
+const int VERTICES = 100000;
+const int EDGES_PER_SECOND = 8; // stream timestamps advance by one every 8 edges
+const int EXPIRATION_THRESHOLD = 50000;
+const int PUBLISH_EVERY = 1 << 12;
+const int READER_COUNTS[] = {0, 1, 2, 4};
+
+struct ReaderStats {
+    long long queries;
+    long long checksum; // keeps the query results live
+    vector<double> latencies; // microseconds
+    ReaderStats() : queries(0), checksum(0) {}
+};
+
+// Query the latest snapshot until the writer is done: vertex and edge queries over
+// the last expiration period of the snapshot
+void runReader(const ConcurrentSketch& sketch, int id, const atomic<bool>& done, ReaderStats& stats) {
+    mt19937 gen(id + 1);
+    uniform_int_distribution<> vertexDist(0, VERTICES - 1);
+    while (!done.load(memory_order_acquire)) {
+        auto start = chrono::steady_clock::now();
+        {
+            SnapshotGuard guard(sketch, id);
+            int t_e = (int)(guard.edges() / EDGES_PER_SECOND);
+            int t_b = t_e - EXPIRATION_THRESHOLD;
+            int v = vertexDist(gen);
+            stats.checksum += totalOutgoingWeight(guard.sketch(), v, t_b, t_e);
+            stats.checksum += checkVertexRelationship(guard.sketch(), make_pair(v, vertexDist(gen)), t_b, t_e);
+        }
+        auto end = chrono::steady_clock::now();
+        stats.latencies.push_back(chrono::duration<double, micro>(end - start).count());
+        stats.queries++;
+    }
+}
+
+double percentile(vector<double>& values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t k = min(values.size() - 1, (size_t)(p * values.size()));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+int main() {
+    cout << "Concurrent read/write benchmark (" << MATRIX_SIZE << "x" << MATRIX_SIZE << ", "
+         << STREAM_EDGES << " edges, snapshot every " << PUBLISH_EVERY << " edges)" << endl;
+
+    mt19937 gen(42);
+    uniform_int_distribution<> vertexDist(0, VERTICES - 1);
+    vector<Edge> stream;
+    stream.reserve(STREAM_EDGES);
+    for (int i = 0; i < STREAM_EDGES; i++) {
+        stream.emplace_back(make_pair(vertexDist(gen), vertexDist(gen)), 1, i / EDGES_PER_SECOND);
+    }
+
+    // What every publish cost before it became incremental: a copy of the whole sketch
+    // into a reused snapshot, whose edge storage is already in place
+    double fullCopyUs;
+    {
+        GeminiSketch filled(MATRIX_SIZE, EXPIRATION_THRESHOLD, 0, HASH_CHAIN_LENGTH);
+        insertBatch(filled, stream.data(), stream.size() / 2);
+        GeminiSketch copy(MATRIX_SIZE, EXPIRATION_THRESHOLD, 0, HASH_CHAIN_LENGTH);
+        copySketch(filled, copy);
+        auto start = chrono::steady_clock::now();
+        copySketch(filled, copy);
+        fullCopyUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    }
+    cout << "full sketch copy: " << fullCopyUs << " us" << endl;
+
+    for (int readers : READER_COUNTS) {
+        ConcurrentSketch sketch(MATRIX_SIZE, EXPIRATION_THRESHOLD, max(readers, 1), 0, HASH_CHAIN_LENGTH, PUBLISH_EVERY);
+        atomic<bool> done(false);
+        vector<ReaderStats> stats(readers);
+        vector<thread> threads;
+        for (int id = 0; id < readers; id++) {
+            threads.emplace_back(runReader, cref(sketch), id, cref(done), ref(stats[id]));
+        }
+
+        auto start = chrono::steady_clock::now();
+        for (const auto& edge : stream) {
+            insertion(sketch, edge);
+        }
+        auto end = chrono::steady_clock::now();
+        done.store(true, memory_order_release);
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        double seconds = chrono::duration<double>(end - start).count();
+        long long queries = 0;
+        vector<double> latencies;
+        for (auto& s : stats) {
+            queries += s.queries;
+            latencies.insert(latencies.end(), s.latencies.begin(), s.latencies.end());
+        }
+
+        cout << readers << " readers: insert " << STREAM_EDGES / seconds / 1e6 << " Mops";
+        if (readers > 0) {
+            cout << ", queries " << queries / seconds / 1e6 << " Mops"
+                 << ", latency p50 " << percentile(latencies, 0.5) << " us"
+                 << ", p99 " << percentile(latencies, 0.99) << " us";
+        }
+        cout << ", snapshots kept " << sketch.pool.size() + sketch.retired.size() + 1 << endl;
+
+        const ConcurrentSketch::PublishStats& publishes = sketch.publishStats;
+        if (publishes.publishes > 0) {
+            cout << "  publish: " << publishes.publishes << " pauses, mean " << publishes.nanos / 1e3 / publishes.publishes
+                 << " us, max " << publishes.maxNanos / 1e3 << " us, " << publishes.bucketsCopied / publishes.publishes
+                 << " buckets copied each, " << publishes.nanos / 1e9 / seconds * 100 << "% of ingest time, "
+                 << publishes.deferred << " deferred" << endl;
+        }
+    }
+    return 0;
+}
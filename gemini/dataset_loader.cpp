@@ -0,0 +1,322 @@
+#include "dataset_loader.h"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) : data(nullptr), size(0), fd(-1) {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        return;
+    }
+    void* p = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        return;
+    }
+    madvise(p, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char*>(p);
+    size = static_cast<std::size_t>(st.st_size);
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+}
+
+bool hasHeaderLine(const std::string& path) {
+    return path.find(".tsv") != std::string::npos || path.find(".txt") != std::string::npos;
+}
+
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Parse the signed integer at p (p < end, not blank). Returns false unless it is a
+// whole field that fits in an int; p is left just past the field.
+static inline bool parseInt(const char*& p, const char* end, int& value) {
+    bool negative = false;
+    if (*p == '-' || *p == '+') {
+        negative = *p == '-';
+        ++p;
+    }
+    const char* digits = p;
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        if (v > 2147483648LL) {
+            return false;
+        }
+        ++p;
+    }
+    if (p == digits || (p < end && !isBlank(*p))) {
+        return false;
+    }
+    v = negative ? -v : v;
+    if (v > INT_MAX || v < INT_MIN) {
+        return false;
+    }
+    value = static_cast<int>(v);
+    return true;
+}
+
+// Parse the edges of the lines in [p, end) and append them to edges, stopping once
+// edges holds limit entries. Returns the start of the first line not parsed.
+static const char* parseLines(const char* p, const char* end, std::vector<Edge>& edges,
+                              std::size_t limit = static_cast<std::size_t>(-1)) {
+    while (p < end && edges.size() < limit) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+
+        int fields[4] = {0, 1, 1, 0};
+        int count = 0;
+        bool valid = true;
+        while (count < 4) {
+            while (p < eol && isBlank(*p)) {
+                ++p;
+            }
+            if (p == eol) {
+                break;
+            }
+            if (!parseInt(p, eol, fields[count])) {
+                valid = false;
+                break;
+            }
+            ++count;
+        }
+        if (valid && count >= 3) {
+            edges.emplace_back(std::make_pair(fields[0], fields[1]), fields[2], fields[3]);
+        }
+        p = eol + 1;
+    }
+    return p < end ? p : end;
+}
+
+// Skip the first line of [begin, end)
+static const char* skipLine(const char* begin, const char* end) {
+    const char* eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+    return eol == nullptr ? end : eol + 1;
+}
+
+// Drop the pages of a read-only file mapping from the one holding `from` up to the
+// one holding `to` (exclusive). Nothing is lost: a page touched again is read back
+// from the file.
+static void releasePages(const void* from, const void* to) {
+    static const std::uintptr_t page = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    std::uintptr_t first = reinterpret_cast<std::uintptr_t>(from) / page * page;
+    std::uintptr_t last = reinterpret_cast<std::uintptr_t>(to) / page * page;
+    if (first < last) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+std::vector<Edge> loadEdgeList(const std::string& path, bool skipHeader, int threads) {
+    std::vector<Edge> edges;
+    MappedFile file(path);
+    if (file.data == nullptr) {
+        return edges;
+    }
+
+    const char* begin = file.data;
+    const char* end = file.data + file.size;
+    if (skipHeader) {
+        begin = skipLine(begin, end);
+    }
+
+    std::size_t chunks = threads < 1 ? 1 : static_cast<std::size_t>(threads);
+    if (chunks == 1) {
+        // Lines average well over 8 bytes, so this is an upper bound on the edge count
+        edges.reserve((end - begin) / 8);
+        parseLines(begin, end, edges);
+        return edges;
+    }
+
+    // Split on line boundaries: each chunk ends just past a newline
+    std::vector<const char*> cuts(1, begin);
+    for (std::size_t c = 1; c < chunks; ++c) {
+        const char* cut = begin + (end - begin) * c / chunks;
+        if (cut < cuts.back()) {
+            cut = cuts.back();
+        }
+        const char* eol = static_cast<const char*>(memchr(cut, '\n', end - cut));
+        cuts.push_back(eol == nullptr ? end : eol + 1);
+    }
+    cuts.push_back(end);
+
+    std::vector<std::vector<Edge>> parts(chunks);
+    std::vector<std::thread> workers;
+    for (std::size_t c = 0; c < chunks; ++c) {
+        workers.emplace_back([&, c]() {
+            parts[c].reserve((cuts[c + 1] - cuts[c]) / 8);
+            parseLines(cuts[c], cuts[c + 1], parts[c]);
+        });
+    }
+    std::size_t total = 0;
+    for (std::size_t c = 0; c < chunks; ++c) {
+        workers[c].join();
+        total += parts[c].size();
+    }
+
+    edges.reserve(total);
+    for (std::size_t c = 0; c < chunks; ++c) {
+        edges.insert(edges.end(), parts[c].begin(), parts[c].end());
+    }
+    return edges;
+}
+
+EdgeCache::EdgeCache(const std::string& cachePath) : file_(cachePath), header_(nullptr), columns_(nullptr) {
+    if (file_.data == nullptr || file_.size < sizeof(EdgeCacheHeader)) {
+        return;
+    }
+    const EdgeCacheHeader* header = reinterpret_cast<const EdgeCacheHeader*>(file_.data);
+    if (memcmp(header->magic, "GEMC", 4) != 0 || header->version != EDGE_CACHE_VERSION ||
+        file_.size != sizeof(EdgeCacheHeader) + header->edges * 4 * sizeof(std::int32_t)) {
+        return;
+    }
+    header_ = header;
+    columns_ = reinterpret_cast<const std::int32_t*>(file_.data + sizeof(EdgeCacheHeader));
+}
+
+bool EdgeCache::matches(const std::string& sourcePath) const {
+    struct stat st;
+    if (stat(sourcePath.c_str(), &st) == -1) {
+        return true;
+    }
+    return header_->sourceSize == static_cast<std::uint64_t>(st.st_size) &&
+           header_->sourceMtime == static_cast<std::int64_t>(st.st_mtime);
+}
+
+std::string edgeCachePath(const std::string& path) {
+    return path + ".gemc";
+}
+
+// Write one column through a bounded buffer
+template <typename Field>
+static bool writeColumn(FILE* out, const std::vector<Edge>& edges, Field field) {
+    std::vector<std::int32_t> buffer;
+    buffer.reserve(1 << 16);
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+        buffer.push_back(field(edges[i]));
+        if (buffer.size() == buffer.capacity() || i + 1 == edges.size()) {
+            if (fwrite(buffer.data(), sizeof(std::int32_t), buffer.size(), out) != buffer.size()) {
+                return false;
+            }
+            buffer.clear();
+        }
+    }
+    return true;
+}
+
+static std::int32_t edgeSource(const Edge& e) { return e.sd.first; }
+static std::int32_t edgeTarget(const Edge& e) { return e.sd.second; }
+static std::int32_t edgeWeight(const Edge& e) { return e.weight; }
+static std::int32_t edgeTime(const Edge& e) { return e.time; }
+
+bool writeEdgeCache(const std::string& cachePath, const std::vector<Edge>& edges, const std::string& sourcePath) {
+    EdgeCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "GEMC", 4);
+    header.version = EDGE_CACHE_VERSION;
+    header.edges = edges.size();
+    header.minTime = edges.empty() ? 0 : INT_MAX;
+    header.maxTime = edges.empty() ? 0 : INT_MIN;
+    for (std::size_t i = 0; i < edges.size(); ++i) {
+        header.minTime = std::min(header.minTime, static_cast<std::int32_t>(edges[i].time));
+        header.maxTime = std::max(header.maxTime, static_cast<std::int32_t>(edges[i].time));
+    }
+    struct stat st;
+    if (stat(sourcePath.c_str(), &st) == 0) {
+        header.sourceSize = static_cast<std::uint64_t>(st.st_size);
+        header.sourceMtime = static_cast<std::int64_t>(st.st_mtime);
+    }
+
+    std::string tmpPath = cachePath + ".tmp";
+    FILE* out = fopen(tmpPath.c_str(), "wb");
+    if (out == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              writeColumn(out, edges, edgeSource) && writeColumn(out, edges, edgeTarget) &&
+              writeColumn(out, edges, edgeWeight) && writeColumn(out, edges, edgeTime);
+    ok = fclose(out) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+EdgeTable::EdgeTable(const std::string& path, int threads) : cache_(edgeCachePath(path)), fromCache_(false) {
+    // A stale cache is ignored and the text parsed instead
+    fromCache_ = cache_.valid() && cache_.matches(path);
+    if (!fromCache_) {
+        parsed_ = loadEdgeList(path, hasHeaderLine(path), threads);
+    }
+}
+
+EdgeWindow EdgeTable::window(std::size_t begin, std::size_t count, std::vector<Edge>& buffer) const {
+    std::size_t end = std::min(size(), begin + count);
+    begin = std::min(begin, end);
+    if (!fromCache_) {
+        return EdgeWindow(parsed_.data() + begin, end - begin);
+    }
+    buffer.clear();
+    for (std::size_t i = begin; i < end; ++i) {
+        buffer.push_back(cache_.edge(i));
+    }
+    return EdgeWindow(buffer.data(), buffer.size());
+}
+
+EdgeStream::EdgeStream(const std::string& path, std::size_t windowSize)
+    : windowSize_(windowSize == 0 ? 1 : windowSize), cache_(edgeCachePath(path)), fromCache_(false), index_(0),
+      begin_(nullptr), pos_(nullptr) {
+    // A stale cache is ignored, as in EdgeTable
+    fromCache_ = cache_.valid() && cache_.matches(path);
+    text_.reset(new MappedFile(fromCache_ ? std::string() : path));
+    if (text_->data != nullptr) {
+        begin_ = text_->data;
+        if (hasHeaderLine(path)) {
+            begin_ = skipLine(begin_, text_->data + text_->size);
+        }
+        pos_ = begin_;
+    }
+    buffer_.reserve(windowSize_);
+}
+
+bool EdgeStream::next(EdgeWindow& window) {
+    buffer_.clear();
+    if (fromCache_) {
+        std::size_t end = std::min(cache_.size(), index_ + windowSize_);
+        for (std::size_t i = index_; i < end; ++i) {
+            buffer_.push_back(cache_.edge(i));
+        }
+        const std::int32_t* columns[4] = {cache_.sources(), cache_.targets(), cache_.weights(), cache_.times()};
+        for (int c = 0; c < 4; ++c) {
+            releasePages(columns[c] + index_, columns[c] + end);
+        }
+        index_ = end;
+    } else if (text_->data != nullptr) {
+        const char* start = pos_;
+        pos_ = parseLines(pos_, text_->data + text_->size, buffer_, windowSize_);
+        releasePages(start, pos_);
+    }
+    window = EdgeWindow(buffer_.data(), buffer_.size());
+    return !buffer_.empty();
+}
+
+void EdgeStream::rewind() {
+    index_ = 0;
+    pos_ = begin_;
+}
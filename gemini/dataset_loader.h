@@ -0,0 +1,163 @@
+#ifndef DATASET_LOADER_H
+#define DATASET_LOADER_H
+
+#include "GeminiSketch_Algorithm.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Read-only mapping of a whole file; data is null if it cannot be opened or is empty
+struct MappedFile {
+    const char* data;
+    std::size_t size;
+    int fd;
+
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+// Non-owning view of consecutive edges
+struct EdgeWindow {
+    const Edge* data;
+    std::size_t size;
+
+    EdgeWindow() : data(nullptr), size(0) {}
+    EdgeWindow(const Edge* data, std::size_t size) : data(data), size(size) {}
+
+    const Edge* begin() const { return data; }
+    const Edge* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+};
+
+// Whether a text dataset starts with a header line (.tsv and .txt files do)
+bool hasHeaderLine(const std::string& path);
+
+// Load a text edge list ("source target weight [time]" per line, whitespace separated)
+// The file is memory-mapped and parsed in place. Lines with fewer than three integer
+// fields (comments, headers, malformed rows) are skipped; the first line is skipped
+// when skipHeader is set. With threads > 1 the file is split into chunks on line
+// boundaries and parsed in parallel; the edges keep the file order either way.
+// Returns an empty list if the file cannot be opened.
+std::vector<Edge> loadEdgeList(const std::string& path, bool skipHeader, int threads = 1);
+
+// Binary edge cache, written next to a text dataset as <path>.gemc
+// Layout (native byte order): an EdgeCacheHeader, then four int32 columns of `edges` entries each, in the
+// order source, target, weight, time. The header records the size and modification
+// time of the text file it was built from, so a stale cache is ignored.
+const std::uint32_t EDGE_CACHE_VERSION = 1;
+
+struct EdgeCacheHeader {
+    char magic[4]; // "GEMC"
+    std::uint32_t version;
+    std::uint64_t edges;
+    std::int32_t minTime;
+    std::int32_t maxTime;
+    std::uint64_t sourceSize;
+    std::int64_t sourceMtime;
+};
+
+// A mapped edge cache; the columns point straight into the mapping
+class EdgeCache {
+public:
+    explicit EdgeCache(const std::string& cachePath);
+
+    // Magic, version and file size check out
+    bool valid() const { return header_ != nullptr; }
+    // The cache was built from the text file at sourcePath as it is now. A missing
+    // text file is accepted, so the text can be deleted once converted.
+    bool matches(const std::string& sourcePath) const;
+
+    const EdgeCacheHeader& header() const { return *header_; }
+    std::size_t size() const { return static_cast<std::size_t>(header_->edges); }
+    const std::int32_t* sources() const { return columns_; }
+    const std::int32_t* targets() const { return columns_ + size(); }
+    const std::int32_t* weights() const { return columns_ + 2 * size(); }
+    const std::int32_t* times() const { return columns_ + 3 * size(); }
+    Edge edge(std::size_t i) const {
+        return Edge(std::make_pair(sources()[i], targets()[i]), weights()[i], times()[i]);
+    }
+
+private:
+    MappedFile file_;
+    const EdgeCacheHeader* header_;
+    const std::int32_t* columns_;
+};
+
+// Path of the cache for a text dataset
+std::string edgeCachePath(const std::string& path);
+
+// Write edges as a cache for the text file at sourcePath; returns false on I/O failure.
+// The cache is written to a temporary file and renamed into place.
+bool writeEdgeCache(const std::string& cachePath, const std::vector<Edge>& edges, const std::string& sourcePath);
+
+// A whole dataset with random access and no second copy: the columns of an up-to-date
+// binary cache, read in place from the mapping, or else the edges parsed from the
+// text file. Ingestion goes window by window: a window is a view into the parsed
+// edges, or decoded from the cache columns into a buffer the caller reuses.
+class EdgeTable {
+public:
+    EdgeTable(const std::string& path, int threads = 1);
+
+    bool fromCache() const { return fromCache_; }
+    std::size_t size() const { return fromCache_ ? cache_.size() : parsed_.size(); }
+    bool empty() const { return size() == 0; }
+    Edge operator[](std::size_t i) const { return fromCache_ ? cache_.edge(i) : parsed_[i]; }
+
+    // View of edges [begin, begin + count), clipped to the end of the table; it stays
+    // valid until buffer changes
+    EdgeWindow window(std::size_t begin, std::size_t count, std::vector<Edge>& buffer) const;
+
+    // The backing store: cache() if fromCache(), parsed() otherwise
+    const EdgeCache& cache() const { return cache_; }
+    const std::vector<Edge>& parsed() const { return parsed_; }
+
+private:
+    EdgeTable(const EdgeTable&);
+    EdgeTable& operator=(const EdgeTable&);
+
+    EdgeCache cache_;
+    bool fromCache_;
+    std::vector<Edge> parsed_;
+};
+
+// Reads a dataset window by window without materialising it: from the binary cache
+// when an up-to-date one exists, otherwise by parsing the text file incrementally.
+// Only the current window is held in memory, and the pages of the file already
+// consumed are dropped from the mapping, so a stream costs one window of edges.
+class EdgeStream {
+public:
+    EdgeStream(const std::string& path, std::size_t windowSize);
+
+    // The dataset could be opened
+    bool valid() const { return fromCache_ || text_->data != nullptr; }
+    bool fromCache() const { return fromCache_; }
+
+    // View of the next window of up to windowSize edges; false at the end of the
+    // stream. The view stays valid until the next call.
+    bool next(EdgeWindow& window);
+    // Start again from the first edge
+    void rewind();
+
+    // Memory held for the current window
+    std::size_t bufferBytes() const { return buffer_.capacity() * sizeof(Edge); }
+
+private:
+    EdgeStream(const EdgeStream&);
+    EdgeStream& operator=(const EdgeStream&);
+
+    std::size_t windowSize_;
+    std::vector<Edge> buffer_;
+    EdgeCache cache_;
+    bool fromCache_;
+    std::size_t index_; // next cache edge
+    std::unique_ptr<MappedFile> text_;
+    const char* begin_; // first data line of the text
+    const char* pos_; // next text line
+};
+
+#endif
@@ -1,4 +1,11 @@
 #include "GeminiSketch_Algorithm.h"
+#include "Gemini without switch.h"
+#include "Gemini sharded.h"
+#include "Gemini exact.h"
+#include "Gemini compact.h"
+#include "query_executor.h"
+#include "dataset_loader.h"
+#include "op_stats.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -11,7 +18,7 @@
 #include <unordered_set>
 #include <algorithm>
 #include <cmath>
-#include <sys/time.h>
+#include <cstdlib>
 
 using namespace std;
 
@@ -20,14 +27,21 @@ const int EXPIRATION_THRESHOLD = 100 * 86400; // 100 days in seconds
 const int CONFLICT_THRESHOLD = 20;
 const int HASH_CHAIN_LENGTH = 20;
 const int SHORT_QUEUE_LENGTH = 10;
+const int ROLLING_OUT_STEP = 2; // buckets rolled out per insertion without the switch
+const int SHARD_COUNTS[] = {1, 2, 4, 8}; // ingest workers for the sharded sketch
 const int MEMORY_BUDGET_MB = 20;
+const int COMPACT_BUDGETS_MB[] = {5, 10, 20, 40}; // budgets of the fixed-capacity compact sketch
+const int COMPACT_TIME_GRANULE = 3600; // edges of one <s, d> within an hour share a compact slot
 const int WINDOW_SIZE = 50000;
 const int EDGE_QUERIES = 10000;
 const int VERTEX_QUERIES = 5000;
 const int SUBGRAPH_QUERIES_PER_SIZE = 1000;
 const int PATH_QUERIES_PER_LENGTH = 1000;
+const int PATH_QUERY_WINDOWS = 16; // path queries share these time windows, as a batch of queries over one view would
 const int TOTAL_RUNS = 1000;
-const int QUERY_TIME_RANGE = 100 * 86400; // 100 days in seconds
+const int INSERT_LATENCY_SAMPLE = 64; // every 64th insertion is also timed on its own
+const char* const RESULTS_PREFIX = "experiment_results"; // <prefix>.csv and <prefix>.json, unless given as argv[1]
+const int QUERY_TIME_RANGE = 100 * 86400; // 100 days in seconds, ending at the last edge of the stream
 
 // Dataset information
 struct DatasetInfo {
@@ -50,72 +64,55 @@ struct Metrics {
     double are_vertex;
     double are_subgraph;
     double precision_reachability;
-    double throughput_mops;
-    double memory_usage_mb;
-    double avg_query_time_us;
+    double precision_reachability_batch; // the same queries answered by batchReachabilityQuery (first run)
+    double switch_insert_mops; // insertion throughput with the matrix switch
+    double no_switch_insert_mops; // insertion throughput of the single-matrix ablation
+    double batch_insert_mops; // insertion throughput of insertBatch, one call per window
+    double switch_reserved_mb; // reserved by each of the above once the stream is in (largest run)
+    double no_switch_reserved_mb;
+    double batch_reserved_mb;
+    double memory_usage_mb; // reserved by the sketch, allocator overhead included
+    double memory_live_mb; // holding the matrix structure and the stored edges
+    double memory_fragmentation; // share of the reserved memory holding no live data
+    double exact_memory_mb; // memory of the exact baseline
+    double exact_query_mops; // query throughput of the exact baseline
+    double overflow_rate; // fraction of edges dropped on a full hash chain
+    vector<OpSummary> operations; // throughput and latency per operation type over all runs
 };
 
-// Function to load dataset
-vector<Edge> loadDataset(const string& path) {
-    vector<Edge> edges;
-    ifstream file(path);
-    string line;
-    int lineNum = 0;
-    
-    while (getline(file, line)) {
-        // Skip header lines
-        if (lineNum == 0 && (path.find(".tsv") != string::npos || path.find(".txt") != string::npos)) {
-            lineNum++;
-            continue;
-        }
-        
-        // Parse the line (assuming format: source target weight time)
-        // This will need to be adjusted based on the actual dataset format
-        vector<string> tokens;
-        string token;
-        size_t pos = 0;
-        while ((pos = line.find_first_of(" \t")) != string::npos) {
-            token = line.substr(0, pos);
-            tokens.push_back(token);
-            line.erase(0, pos + 1);
-        }
-        tokens.push_back(line);
-        
-        if (tokens.size() >= 3) {
-            try {
-                int s = stoi(tokens[0]);
-                int d = stoi(tokens[1]);
-                int weight = 1;
-                int time = 0;
-                
-                if (tokens.size() > 2) weight = stoi(tokens[2]);
-                if (tokens.size() > 3) time = stoi(tokens[3]);
-                
-                edges.emplace_back(make_pair(s, d), weight, time);
-            } catch (...) {
-                // Skip invalid lines
-                continue;
-            }
-        }
-        
-        lineNum++;
+// Operation types timed separately in each run
+enum Operation { INSERT, INSERT_NO_SWITCH, INSERT_BATCH, EDGE_QUERY, VERTEX_QUERY, SUBGRAPH_QUERY, PATH_QUERY, PATH_BATCH, OPERATION_COUNT };
+const char* const OPERATION_NAMES[OPERATION_COUNT] = {
+    "insert", "insert_no_switch", "insert_batch", "edge_query", "vertex_query", "subgraph_query", "path_query", "path_batch"
+};
+
+vector<OpStats> makeOpStats() {
+    vector<OpStats> stats;
+    for (int op = 0; op < OPERATION_COUNT; op++) {
+        stats.push_back(OpStats(OPERATION_NAMES[op]));
     }
-    
-    return edges;
+    return stats;
 }
 
-// Function to split edges into windows
-vector<vector<Edge>> splitIntoWindows(const vector<Edge>& edges, int windowSize) {
-    vector<vector<Edge>> windows;
-    for (size_t i = 0; i < edges.size(); i += windowSize) {
-        size_t end = min(i + windowSize, edges.size());
-        windows.push_back(vector<Edge>(edges.begin() + i, edges.begin() + end));
+// Hand the dataset to ingest one WINDOW_SIZE window at a time: a view into the parsed
+// edges, or the window decoded from the cache columns into one reused buffer. Returns
+// the nanoseconds spent in ingest, so the decoding is not timed.
+template <typename Ingest>
+long long forEachWindow(const EdgeTable& edges, Ingest ingest) {
+    vector<Edge> buffer;
+    buffer.reserve(WINDOW_SIZE);
+    long long nanos = 0;
+    for (size_t i = 0; i < edges.size(); i += WINDOW_SIZE) {
+        EdgeWindow window = edges.window(i, WINDOW_SIZE, buffer);
+        long long start = monotonicNanos();
+        ingest(window);
+        nanos += monotonicNanos() - start;
     }
-    return windows;
+    return nanos;
 }
 
 // Generate random edge queries
-vector<tuple<int, int, int, int>> generateEdgeQueries(const vector<Edge>& edges, int numQueries) {
+vector<tuple<int, int, int, int>> generateEdgeQueries(const EdgeTable& edges, int numQueries, int timeBase) {
     vector<tuple<int, int, int, int>> queries;
     random_device rd;
     mt19937 gen(rd());
@@ -123,9 +120,11 @@ vector<tuple<int, int, int, int>> generateEdgeQueries(const vector<Edge>& edges,
     uniform_int_distribution<> timeDist(0, QUERY_TIME_RANGE);
     
     for (int i = 0; i < numQueries; i++) {
-        const Edge& e = edges[edgeDist(gen)];
+        Edge e = edges[edgeDist(gen)];
         int t_b = timeDist(gen);
         int t_e = t_b + timeDist(gen) % (QUERY_TIME_RANGE - t_b + 1);
+        t_b += timeBase;
+        t_e += timeBase;
         queries.emplace_back(e.sd.first, e.sd.second, t_b, t_e);
     }
     
@@ -133,12 +132,13 @@ vector<tuple<int, int, int, int>> generateEdgeQueries(const vector<Edge>& edges,
 }
 
 // Generate random vertex queries
-vector<tuple<int, int, int>> generateVertexQueries(const vector<Edge>& edges, int numQueries) {
+vector<tuple<int, int, int>> generateVertexQueries(const EdgeTable& edges, int numQueries, int timeBase) {
     vector<tuple<int, int, int>> queries;
     unordered_set<int> vertices;
     
     // Collect all vertices
-    for (const auto& e : edges) {
+    for (size_t i = 0; i < edges.size(); i++) {
+        Edge e = edges[i];
         vertices.insert(e.sd.first);
         vertices.insert(e.sd.second);
     }
@@ -153,6 +153,8 @@ vector<tuple<int, int, int>> generateVertexQueries(const vector<Edge>& edges, in
         int v = verticesVec[vertexDist(gen)];
         int t_b = timeDist(gen);
         int t_e = t_b + timeDist(gen) % (QUERY_TIME_RANGE - t_b + 1);
+        t_b += timeBase;
+        t_e += timeBase;
         queries.emplace_back(v, t_b, t_e);
     }
     
@@ -160,7 +162,7 @@ vector<tuple<int, int, int>> generateVertexQueries(const vector<Edge>& edges, in
 }
 
 // Generate random subgraph queries
-vector<tuple<vector<pair<int, int>>, int, int>> generateSubgraphQueries(const vector<Edge>& edges, int numQueries, int minSize, int maxSize) {
+vector<tuple<vector<pair<int, int>>, int, int>> generateSubgraphQueries(const EdgeTable& edges, int numQueries, int minSize, int maxSize, int timeBase) {
     vector<tuple<vector<pair<int, int>>, int, int>> queries;
     random_device rd;
     mt19937 gen(rd());
@@ -173,25 +175,44 @@ vector<tuple<vector<pair<int, int>>, int, int>> generateSubgraphQueries(const ve
         vector<pair<int, int>> edgesInSubgraph;
         
         for (int j = 0; j < size; j++) {
-            const Edge& e = edges[edgeDist(gen)];
+            Edge e = edges[edgeDist(gen)];
             edgesInSubgraph.push_back(e.sd);
         }
         
         int t_b = timeDist(gen);
         int t_e = t_b + timeDist(gen) % (QUERY_TIME_RANGE - t_b + 1);
+        t_b += timeBase;
+        t_e += timeBase;
         queries.emplace_back(edgesInSubgraph, t_b, t_e);
     }
     
     return queries;
 }
 
-// Generate random path queries
-vector<tuple<vector<int>, int, int>> generatePathQueries(const vector<Edge>& edges, int numQueries, int length) {
+// Generate random query windows within [timeBase, timeBase + QUERY_TIME_RANGE]
+vector<pair<int, int>> generateQueryWindows(int numWindows, int timeBase) {
+    vector<pair<int, int>> windows;
+    random_device rd;
+    mt19937 gen(rd());
+    uniform_int_distribution<> timeDist(0, QUERY_TIME_RANGE);
+    
+    for (int i = 0; i < numWindows; i++) {
+        int t_b = timeDist(gen);
+        int t_e = t_b + timeDist(gen) % (QUERY_TIME_RANGE - t_b + 1);
+        windows.emplace_back(t_b + timeBase, t_e + timeBase);
+    }
+    
+    return windows;
+}
+
+// Generate random path queries, each over one of the given windows
+vector<tuple<vector<int>, int, int>> generatePathQueries(const EdgeTable& edges, int numQueries, int length, const vector<pair<int, int>>& windows) {
     vector<tuple<vector<int>, int, int>> queries;
     unordered_map<int, vector<int>> adjList;
     
     // Build adjacency list
-    for (const auto& e : edges) {
+    for (size_t i = 0; i < edges.size(); i++) {
+        Edge e = edges[i];
         adjList[e.sd.first].push_back(e.sd.second);
     }
     
@@ -207,7 +228,7 @@ vector<tuple<vector<int>, int, int>> generatePathQueries(const vector<Edge>& edg
     random_device rd;
     mt19937 gen(rd());
     uniform_int_distribution<> sourceDist(0, sources.size() - 1);
-    uniform_int_distribution<> timeDist(0, QUERY_TIME_RANGE);
+    uniform_int_distribution<> windowDist(0, windows.size() - 1);
     
     for (int i = 0; i < numQueries; i++) {
         vector<int> path;
@@ -226,8 +247,7 @@ vector<tuple<vector<int>, int, int>> generatePathQueries(const vector<Edge>& edg
         
         // Only add paths that reached the desired length
         if (path.size() == length) {
-            int t_b = timeDist(gen);
-            int t_e = t_b + timeDist(gen) % (QUERY_TIME_RANGE - t_b + 1);
+            const auto& [t_b, t_e] = windows[windowDist(gen)];
             queries.emplace_back(path, t_b, t_e);
         }
     }
@@ -235,159 +255,454 @@ vector<tuple<vector<int>, int, int>> generatePathQueries(const vector<Edge>& edg
     return queries;
 }
 
+// Exact answers of every query, computed once per dataset on the exact graph
+struct GroundTruth {
+    vector<bool> edge;
+    vector<long long> vertex;
+    vector<long long> subgraph;
+    vector<PathQuery> pathBatch; // path queries with at least two vertices, as first -> last
+    vector<bool> path;
+};
+
+// Subgraph query edges as the sketch takes them
+vector<Edge> subgraphEdges(const vector<pair<int, int>>& edgesInSubgraph, int t_b, int t_e) {
+    vector<Edge> subgraph;
+    for (const auto& sd : edgesInSubgraph) {
+        subgraph.emplace_back(sd, 1, (t_b + t_e) / 2);
+    }
+    return subgraph;
+}
+
+// Answer every query on the exact graph
+GroundTruth computeGroundTruth(const ExactGraph& graph,
+                               const vector<tuple<int, int, int, int>>& edgeQueries,
+                               const vector<tuple<int, int, int>>& vertexQueries,
+                               const vector<tuple<vector<pair<int, int>>, int, int>>& subgraphQueries,
+                               const vector<vector<Edge>>& subgraphs,
+                               const vector<tuple<vector<int>, int, int>>& pathQueries) {
+    GroundTruth truth;
+    for (const auto& [s, d, t_b, t_e] : edgeQueries) {
+        truth.edge.push_back(checkVertexRelationship(graph, make_pair(s, d), t_b, t_e));
+    }
+    for (const auto& [v, t_b, t_e] : vertexQueries) {
+        truth.vertex.push_back(totalOutgoingWeight(graph, v, t_b, t_e));
+    }
+    for (size_t i = 0; i < subgraphQueries.size(); i++) {
+        truth.subgraph.push_back(subgraphQuery(graph, subgraphs[i], get<1>(subgraphQueries[i]), get<2>(subgraphQueries[i]), false));
+    }
+    for (const auto& [path, t_b, t_e] : pathQueries) {
+        if (path.size() >= 2) {
+            truth.pathBatch.emplace_back(make_pair(path.front(), path.back()), t_b, t_e);
+            truth.path.push_back(reachabilityQuery(graph, make_pair(path.front(), path.back()), t_b, t_e));
+        }
+    }
+    return truth;
+}
+
 // Run edge existence query and calculate error
-pair<bool, double> runEdgeQuery(const WorkingMatrix& matrix, int s, int d, int t_b, int t_e, bool groundTruth) {
-    // In a real implementation, we would run both GeminiSketch and the ground truth
-    // For this example, we're just simulating the results
+template <typename Sketch>
+pair<bool, double> runEdgeQuery(const Sketch& matrix, int s, int d, int t_b, int t_e, bool groundTruth) {
     bool result = checkVertexRelationship(matrix, make_pair(s, d), t_b, t_e);
     double error = (result == groundTruth) ? 0.0 : 1.0;
     return {result, error};
 }
 
 // Run vertex query and calculate error
-pair<int, double> runVertexQuery(const WorkingMatrix& matrix, int v, int t_b, int t_e, int groundTruthWeight) {
+template <typename Sketch>
+pair<int, double> runVertexQuery(const Sketch& matrix, int v, int t_b, int t_e, long long groundTruthWeight) {
     int result = totalOutgoingWeight(matrix, v, t_b, t_e);
     double error = groundTruthWeight > 0 ? abs(result - groundTruthWeight) / (double)groundTruthWeight : 0.0;
     return {result, error};
 }
 
 // Run subgraph query and calculate error
-pair<int, double> runSubgraphQuery(const WorkingMatrix& matrix, const vector<pair<int, int>>& edgesInSubgraph, int t_b, int t_e, int groundTruthWeight) {
-    vector<Edge> subgraph;
-    for (const auto& sd : edgesInSubgraph) {
-        subgraph.emplace_back(sd, 1, (t_b + t_e) / 2);
-    }
-    
-    int result = subgraphQuery(matrix, subgraph, t_b, t_e);
+// Without early exit the sketch returns the weight of the edges it holds, which is
+// what the relative error is taken against
+template <typename Sketch>
+pair<int, double> runSubgraphQuery(const Sketch& matrix, const vector<Edge>& subgraph, int t_b, int t_e, long long groundTruthWeight) {
+    int result = subgraphQuery(matrix, subgraph, t_b, t_e, false);
     double error = groundTruthWeight > 0 ? abs(result - groundTruthWeight) / (double)groundTruthWeight : 0.0;
     return {result, error};
 }
 
-// Run reachability query and calculate precision
-pair<bool, bool> runReachabilityQuery(const WorkingMatrix& matrix, const vector<int>& path, int t_b, int t_e, bool groundTruth) {
-    // In a real implementation, we would check reachability according to the path
-    // For this example, we're just simulating the results for the first and last node
-    if (path.size() < 2) return {false, false};
+// Run reachability query from the first to the last vertex of a path
+template <typename Sketch>
+pair<bool, double> runReachabilityQuery(const Sketch& matrix, const PathQuery& query, bool groundTruth) {
+    bool result = reachabilityQuery(matrix, query.sd, query.t_b, query.t_e);
+    double error = (result == groundTruth) ? 0.0 : 1.0;
+    return {result, error};
+}
+
+// Run a batch of reachability queries through batchReachabilityQuery; returns the
+// answers and how many of them match the ground truth
+template <typename Sketch>
+pair<vector<bool>, int> runReachabilityQuery(const Sketch& matrix, const vector<PathQuery>& queries, const vector<bool>& groundTruth) {
+    vector<bool> results = batchReachabilityQuery(matrix, queries);
+    int correct = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        correct += results[i] == groundTruth[i];
+    }
+    return {results, correct};
+}
+
+// Memory in MB
+double toMB(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// Signed difference after - before in MB: memory can shrink between two readings
+double deltaMB(size_t before, size_t after) {
+    return ((double)after - (double)before) / (1024.0 * 1024.0);
+}
+
+double measureMemoryUsage(const ExactGraph& graph) {
+    return toMB(graph.memoryBytes());
+}
+
+// Sharded ingestion throughput for each worker count; the shards split the budget
+// evenly, so every worker count holds about the same number of cells in total. The
+// workers keep inserting while the next window is decoded, so the whole loop is timed,
+// decoding included.
+void measureShardedIngest(const EdgeTable& edges) {
+    for (int shards : SHARD_COUNTS) {
+        int matrixSize = matrixSizeForBudget((size_t)MEMORY_BUDGET_MB * 1024 * 1024 / 2 / shards);
+        ShardedSketch sketch(shards, matrixSize, EXPIRATION_THRESHOLD, 0, HASH_CHAIN_LENGTH);
+        
+        long long start = monotonicNanos();
+        forEachWindow(edges, [&](const EdgeWindow& window) { insertBatch(sketch, window.data, window.size); });
+        flush(sketch);
+        
+        double elapsed = (monotonicNanos() - start) / 1000.0;
+        size_t cells = (size_t)shards * 2 * matrixSize * matrixSize;
+        cout << "Sharded ingest (" << shards << " workers): " << edges.size() / elapsed << " Mops, " << cells
+             << " cells, " << toMB(memoryStats(sketch).reservedBytes) << " MB reserved" << endl;
+    }
+}
+
+// Ingest the dataset straight from disk one window at a time, as an unbounded stream
+// would arrive: the only edges in memory are those of the current window. The sketch
+// is the only one alive here, so its accounting is checked against the growth of the
+// tracked heap and of the process RSS.
+void measureStreamingIngest(const string& path) {
+    HeapStats heapBefore = heapStats();
+    size_t rssBefore = residentBytes();
+    int matrixSize = matrixSizeForBudget((size_t)MEMORY_BUDGET_MB * 1024 * 1024 / 2);
+    GeminiSketch sketch(matrixSize, EXPIRATION_THRESHOLD, 0, HASH_CHAIN_LENGTH);
+    EdgeStream stream(path, WINDOW_SIZE);
+    EdgeWindow window;
+    size_t edgeCount = 0;
+    
+    long long start = monotonicNanos();
+    while (stream.next(window)) {
+        insertBatch(sketch, window.data, window.size);
+        edgeCount += window.size;
+    }
     
-    bool result = reachabilityQuery(matrix, make_pair(path.front(), path.back()), t_b, t_e);
-    return {result, result == groundTruth};
+    double elapsed = (monotonicNanos() - start) / 1000.0;
+    cout << "Streaming ingest (" << (stream.fromCache() ? "cache" : "text") << "): "
+         << edgeCount / elapsed << " Mops, window buffer " << toMB(stream.bufferBytes()) << " MB" << endl;
+    
+    MemoryStats memory = memoryStats(sketch);
+    HeapStats heapAfter = heapStats();
+    size_t rssAfter = residentBytes();
+    cout << "Sketch memory: " << toMB(memory.reservedBytes) << " MB reserved, " << toMB(memory.liveBytes)
+         << " MB live, " << memory.allocations << " blocks, fragmentation " << memory.fragmentation() * 100
+         << "% (budget " << MEMORY_BUDGET_MB << " MB)" << endl;
+    cout << "Tracked heap growth: " << deltaMB(heapBefore.reservedBytes, heapAfter.reservedBytes) << " MB in "
+         << (long long)heapAfter.liveBlocks - (long long)heapBefore.liveBlocks << " blocks ("
+         << heapAfter.allocations - heapBefore.allocations << " allocations), RSS growth: "
+         << (rssBefore > 0 && rssAfter > 0 ? deltaMB(rssBefore, rssAfter) : 0) << " MB" << endl;
+}
+
+// Wall time of one parallel query batch, in microseconds
+double timeQueryBatch(QueryExecutor& executor, size_t count, const function<void(size_t)>& query) {
+    long long start = monotonicNanos();
+    executor.parallelFor(count, query);
+    return (monotonicNanos() - start) / 1000.0;
+}
+
+// Per-type query throughput on one read-only sketch at 1, 2, 4, ... threads
+void measureQueryScaling(const GeminiSketch& sketch,
+                         const vector<tuple<int, int, int, int>>& edgeQueries,
+                         const vector<tuple<int, int, int>>& vertexQueries,
+                         const vector<tuple<vector<pair<int, int>>, int, int>>& subgraphQueries,
+                         const vector<vector<Edge>>& subgraphs,
+                         const vector<tuple<vector<int>, int, int>>& pathQueries) {
+    vector<long long> results(max(max(edgeQueries.size(), vertexQueries.size()), max(subgraphQueries.size(), pathQueries.size())));
+    int maxThreads = max(4, (int)thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        QueryExecutor executor(threads);
+        double edgeTime = timeQueryBatch(executor, edgeQueries.size(), [&](size_t i) {
+            const auto& [s, d, t_b, t_e] = edgeQueries[i];
+            results[i] = checkVertexRelationship(sketch, make_pair(s, d), t_b, t_e);
+        });
+        double vertexTime = timeQueryBatch(executor, vertexQueries.size(), [&](size_t i) {
+            const auto& [v, t_b, t_e] = vertexQueries[i];
+            results[i] = totalOutgoingWeight(sketch, v, t_b, t_e);
+        });
+        double subgraphTime = timeQueryBatch(executor, subgraphQueries.size(), [&](size_t i) {
+            results[i] = subgraphQuery(sketch, subgraphs[i], get<1>(subgraphQueries[i]), get<2>(subgraphQueries[i]), false);
+        });
+        double pathTime = timeQueryBatch(executor, pathQueries.size(), [&](size_t i) {
+            const auto& [path, t_b, t_e] = pathQueries[i];
+            results[i] = path.size() >= 2 && reachabilityQuery(sketch, make_pair(path.front(), path.back()), t_b, t_e);
+        });
+        
+        cout << "Query throughput (" << threads << " threads): edge " << edgeQueries.size() / edgeTime
+             << ", vertex " << vertexQueries.size() / vertexTime
+             << ", subgraph " << subgraphQueries.size() / subgraphTime
+             << ", path " << pathQueries.size() / pathTime << " Mops" << endl;
+    }
+}
+
+// Insert the dataset edge by edge: the whole stream is timed for throughput, and every
+// INSERT_LATENCY_SAMPLE-th insertion also on its own for the latency histogram
+template <typename Sketch>
+void timeInsertions(Sketch& sketch, const EdgeTable& edges, OpStats& stats) {
+    size_t inserted = 0;
+    long long nanos = forEachWindow(edges, [&](const EdgeWindow& window) {
+        for (const auto& edge : window) {
+            if (++inserted % INSERT_LATENCY_SAMPLE == 0) {
+                long long t = monotonicNanos();
+                insertion(sketch, edge);
+                stats.sample(monotonicNanos() - t);
+            } else {
+                insertion(sketch, edge);
+            }
+        }
+    });
+    stats.recordSpan(edges.size(), nanos);
 }
 
-// Measure memory usage
-double measureMemoryUsage(const WorkingMatrix& matrix) {
-    // This is a simplified memory usage calculation
-    // In a real implementation, you would use platform-specific memory measurement APIs
-    size_t totalBytes = sizeof(matrix);
-    for (const auto& row : matrix.G) {
-        totalBytes += sizeof(row);
-        for (const auto& bucket : row) {
-            totalBytes += sizeof(bucket);
-            totalBytes += bucket.list.size() * sizeof(Edge);
+// Accuracy of the compact sketch at each budget, on the queries and answers of the
+// main runs. Its memory is laid out when it is built, so the tracked heap must not
+// grow during the ingest.
+void measureCompactAccuracy(const EdgeTable& edges,
+                            const vector<tuple<int, int, int, int>>& edgeQueries,
+                            const vector<tuple<int, int, int>>& vertexQueries,
+                            const vector<tuple<vector<pair<int, int>>, int, int>>& subgraphQueries,
+                            const vector<vector<Edge>>& subgraphs, const GroundTruth& truth) {
+    for (int budgetMB : COMPACT_BUDGETS_MB) {
+        CompactSketch sketch((size_t)budgetMB * 1024 * 1024, EXPIRATION_THRESHOLD, COMPACT_TIME_GRANULE);
+        HeapStats heapBefore = heapStats();
+        
+        double elapsed = forEachWindow(edges, [&](const EdgeWindow& window) {
+            insertBatch(sketch, window.data, window.size);
+        }) / 1000.0;
+        HeapStats heapAfter = heapStats();
+        
+        double edgeError = 0;
+        for (size_t i = 0; i < edgeQueries.size(); i++) {
+            const auto& [s, d, t_b, t_e] = edgeQueries[i];
+            edgeError += runEdgeQuery(sketch, s, d, t_b, t_e, truth.edge[i]).second;
+        }
+        double vertexError = 0;
+        for (size_t i = 0; i < vertexQueries.size(); i++) {
+            const auto& [v, t_b, t_e] = vertexQueries[i];
+            vertexError += runVertexQuery(sketch, v, t_b, t_e, truth.vertex[i]).second;
+        }
+        double subgraphError = 0;
+        for (size_t i = 0; i < subgraphQueries.size(); i++) {
+            const auto& [edgesInSubgraph, t_b, t_e] = subgraphQueries[i];
+            subgraphError += runSubgraphQuery(sketch, subgraphs[i], t_b, t_e, truth.subgraph[i]).second;
+        }
+        int correctReachability = 0;
+        for (size_t i = 0; i < truth.pathBatch.size(); i++) {
+            correctReachability += runReachabilityQuery(sketch, truth.pathBatch[i], truth.path[i]).second == 0.0;
         }
+        
+        MemoryStats memory = memoryStats(sketch);
+        long long aggregated = sketch.M0.aggregated + sketch.M1.aggregated;
+        long long evicted = sketch.M0.evicted + sketch.M1.evicted;
+        cout << "Compact sketch (" << budgetMB << " MB budget, " << sketch.M0.n << "x" << sketch.M0.n << "x"
+             << sketch.M0.slots << " slots): " << toMB(memory.reservedBytes) << " MB reserved, heap growth "
+             << deltaMB(heapBefore.reservedBytes, heapAfter.reservedBytes) << " MB, " << edges.size() / elapsed << " Mops" << endl;
+        cout << "  ARE edge " << edgeError / edgeQueries.size() << ", vertex " << vertexError / vertexQueries.size()
+             << ", subgraph " << subgraphError / subgraphQueries.size() << ", reachability precision "
+             << (double)correctReachability / truth.pathBatch.size() << "; aggregated " << (double)aggregated / edges.size()
+             << ", evicted " << (double)evicted / edges.size() << " of the edges" << endl;
     }
-    return totalBytes / (1024.0 * 1024.0); // Convert to MB
 }
 
-// Run experiment for a single dataset
-Metrics runExperiment(const DatasetInfo& dataset) {
-    Metrics metrics = {0, 0, 0, 0, 0, 0, 0};
+// Run experiment for a single dataset; per-run and aggregate timings go to results
+Metrics runExperiment(const DatasetInfo& dataset, vector<OpResult>& results) {
+    Metrics metrics = {};
     
     cout << "Loading dataset: " << dataset.name << endl;
-    vector<Edge> edges = loadDataset(dataset.path);
+    // The binary cache (<path>.gemc, see convert_dataset) is read in place when an
+    // up-to-date one exists, otherwise the text file is parsed
+    EdgeTable edges(dataset.path, max(1, (int)thread::hardware_concurrency()));
     
     if (edges.empty()) {
         cerr << "Failed to load dataset: " << dataset.name << endl;
         return metrics;
     }
     
-    cout << "Loaded " << edges.size() << " edges." << endl;
+    cout << "Loaded " << edges.size() << " edges (" << (edges.fromCache() ? "cache" : "text") << ")." << endl;
+    cout << "Split into " << (edges.size() + WINDOW_SIZE - 1) / WINDOW_SIZE << " windows." << endl;
     
-    // Split into windows
-    vector<vector<Edge>> windows = splitIntoWindows(edges, WINDOW_SIZE);
-    cout << "Split into " << windows.size() << " windows." << endl;
+    measureStreamingIngest(dataset.path);
+    measureShardedIngest(edges);
     
-    // Generate queries
+    // Exact baseline over the whole stream, the one time-sorted copy of the edges
+    long long start = monotonicNanos();
+    const EdgeCache& cache = edges.cache();
+    ExactGraph exact = edges.fromCache()
+        ? ExactGraph(cache.sources(), cache.targets(), cache.weights(), cache.times(), cache.size())
+        : ExactGraph(edges.parsed());
+    double buildTime = (monotonicNanos() - start) / 1e9;
+    cout << "Built exact index in " << buildTime << " s (" << measureMemoryUsage(exact) << " MB)" << endl;
+    
+    // Generate queries over the last QUERY_TIME_RANGE of the stream, which both
+    // matrices of the sketch still cover once every edge is in
     cout << "Generating queries..." << endl;
-    auto edgeQueries = generateEdgeQueries(edges, EDGE_QUERIES);
-    auto vertexQueries = generateVertexQueries(edges, VERTEX_QUERIES);
+    int timeBase = exact.time.back() - QUERY_TIME_RANGE;
+    auto edgeQueries = generateEdgeQueries(edges, EDGE_QUERIES, timeBase);
+    auto vertexQueries = generateVertexQueries(edges, VERTEX_QUERIES, timeBase);
     
     vector<tuple<vector<pair<int, int>>, int, int>> subgraphQueries;
     for (int size = 50; size <= 200; size += 50) {
-        auto queries = generateSubgraphQueries(edges, SUBGRAPH_QUERIES_PER_SIZE, size, size);
+        auto queries = generateSubgraphQueries(edges, SUBGRAPH_QUERIES_PER_SIZE, size, size, timeBase);
         subgraphQueries.insert(subgraphQueries.end(), queries.begin(), queries.end());
     }
+    // Edge lists as the sketches take them, built once so no query timing includes them
+    vector<vector<Edge>> subgraphs;
+    for (const auto& [edgesInSubgraph, t_b, t_e] : subgraphQueries) {
+        subgraphs.push_back(subgraphEdges(edgesInSubgraph, t_b, t_e));
+    }
     
     vector<tuple<vector<int>, int, int>> pathQueries;
+    vector<pair<int, int>> pathWindows = generateQueryWindows(PATH_QUERY_WINDOWS, timeBase);
     for (int length = 1; length <= 10; length++) {
-        auto queries = generatePathQueries(edges, PATH_QUERIES_PER_LENGTH, length);
+        auto queries = generatePathQueries(edges, PATH_QUERIES_PER_LENGTH, length, pathWindows);
         pathQueries.insert(pathQueries.end(), queries.begin(), queries.end());
     }
     
+    // Ground truth, timed as the exact baseline's query throughput
+    start = monotonicNanos();
+    GroundTruth truth = computeGroundTruth(exact, edgeQueries, vertexQueries, subgraphQueries, subgraphs, pathQueries);
+    double truthTime = (monotonicNanos() - start) / 1000.0;
+    metrics.exact_memory_mb = measureMemoryUsage(exact);
+    metrics.exact_query_mops = (edgeQueries.size() + vertexQueries.size() + subgraphQueries.size() + truth.pathBatch.size()) / truthTime;
+    
+    measureCompactAccuracy(edges, edgeQueries, vertexQueries, subgraphQueries, subgraphs, truth);
+    
     // Run experiments for multiple runs
     cout << "Running experiments..." << endl;
-    double totalTime = 0;
+    vector<OpStats> totals = makeOpStats();
     double totalEdgeError = 0;
     double totalVertexError = 0;
     double totalSubgraphError = 0;
     int correctReachabilityQueries = 0;
     
     for (int run = 0; run < TOTAL_RUNS; run++) {
-        // Initialize GeminiSketch
-        int matrixSize = sqrt((MEMORY_BUDGET_MB * 1024 * 1024) / sizeof(Bucket));
-        WorkingMatrix matrix(matrixSize);
+        // Initialize GeminiSketch: the two matrices share the memory budget
+        int matrixSize = matrixSizeForBudget((size_t)MEMORY_BUDGET_MB * 1024 * 1024 / 2);
+        GeminiSketch sketch(matrixSize, EXPIRATION_THRESHOLD, run, HASH_CHAIN_LENGTH);
         
-        // Insert edges
-        timeval start, end;
-        gettimeofday(&start, NULL);
+        // Ablation without the switch: one matrix with as many cells as the two above
+        int noSwitchSize = (int)sqrt(2.0 * matrixSize * matrixSize);
+        NoSwitchSketch noSwitch(noSwitchSize, EXPIRATION_THRESHOLD, run, HASH_CHAIN_LENGTH, ROLLING_OUT_STEP);
         
-        for (const auto& window : windows) {
-            for (const auto& edge : window) {
-                insertion(matrix, edge);
-            }
-            
-            // Eliminate expired edges
-            eliminateExpiredEdges(matrix, edge.time - EXPIRATION_THRESHOLD);
-        }
+        vector<OpStats> stats = makeOpStats();
+        
+        // Same stream through the batched path: hashes and bucket prefetches are issued a block ahead
+        GeminiSketch batched(matrixSize, EXPIRATION_THRESHOLD, run, HASH_CHAIN_LENGTH);
+        long long batchedNanos = forEachWindow(edges, [&](const EdgeWindow& window) {
+            insertBatch(batched, window.data, window.size);
+        });
+        stats[INSERT_BATCH].recordSpan(edges.size(), batchedNanos);
+        
+        // Each insertion also rolls out ROLLING_OUT_STEP buckets of expired edges
+        timeInsertions(noSwitch, edges, stats[INSERT_NO_SWITCH]);
+        
+        // Insert edges; expired edges leave with the aging matrix when a new period starts
+        timeInsertions(sketch, edges, stats[INSERT]);
         
-        // Run queries
+        // Memory each variant holds for the same stream, next to its throughput
+        metrics.switch_reserved_mb = max(metrics.switch_reserved_mb, toMB(memoryStats(sketch).reservedBytes));
+        metrics.no_switch_reserved_mb = max(metrics.no_switch_reserved_mb, toMB(memoryStats(noSwitch.matrix).reservedBytes));
+        metrics.batch_reserved_mb = max(metrics.batch_reserved_mb, toMB(memoryStats(batched).reservedBytes));
+        
+        // Run queries, each timed on its own and scored against the exact answers
         double edgeError = 0;
-        for (const auto& [s, d, t_b, t_e] : edgeQueries) {
-            auto [result, error] = runEdgeQuery(matrix, s, d, t_b, t_e, true); // Simulating ground truth
+        for (size_t i = 0; i < edgeQueries.size(); i++) {
+            const auto& [s, d, t_b, t_e] = edgeQueries[i];
+            start = monotonicNanos();
+            auto [result, error] = runEdgeQuery(sketch, s, d, t_b, t_e, truth.edge[i]);
+            stats[EDGE_QUERY].record(monotonicNanos() - start);
             edgeError += error;
         }
         
         double vertexError = 0;
-        for (const auto& [v, t_b, t_e] : vertexQueries) {
-            auto [result, error] = runVertexQuery(matrix, v, t_b, t_e, 10); // Simulating ground truth
+        for (size_t i = 0; i < vertexQueries.size(); i++) {
+            const auto& [v, t_b, t_e] = vertexQueries[i];
+            start = monotonicNanos();
+            auto [result, error] = runVertexQuery(sketch, v, t_b, t_e, truth.vertex[i]);
+            stats[VERTEX_QUERY].record(monotonicNanos() - start);
             vertexError += error;
         }
         
         double subgraphError = 0;
-        for (const auto& [edgesInSubgraph, t_b, t_e] : subgraphQueries) {
-            auto [result, error] = runSubgraphQuery(matrix, edgesInSubgraph, t_b, t_e, edgesInSubgraph.size()); // Simulating ground truth
+        for (size_t i = 0; i < subgraphQueries.size(); i++) {
+            const auto& [edgesInSubgraph, t_b, t_e] = subgraphQueries[i];
+            start = monotonicNanos();
+            auto [result, error] = runSubgraphQuery(sketch, subgraphs[i], t_b, t_e, truth.subgraph[i]);
+            stats[SUBGRAPH_QUERY].record(monotonicNanos() - start);
             subgraphError += error;
         }
         
         int correctReachability = 0;
-        for (const auto& [path, t_b, t_e] : pathQueries) {
-            if (path.size() >= 2) {
-                auto [result, correct] = runReachabilityQuery(matrix, path, t_b, t_e, true); // Simulating ground truth
-                if (correct) correctReachability++;
+        vector<bool> pathResults(truth.pathBatch.size());
+        for (size_t i = 0; i < truth.pathBatch.size(); i++) {
+            start = monotonicNanos();
+            auto [result, error] = runReachabilityQuery(sketch, truth.pathBatch[i], truth.path[i]);
+            stats[PATH_QUERY].record(monotonicNanos() - start);
+            pathResults[i] = result;
+            correctReachability += error == 0.0;
+        }
+        
+        // Measured once: read scaling of each query type, and the path queries as one
+        // batch, where queries over the same window share a snapshot. The batch must
+        // give the per-query answers before its time is recorded.
+        if (run == 0) {
+            measureQueryScaling(sketch, edgeQueries, vertexQueries, subgraphQueries, subgraphs, pathQueries);
+            start = monotonicNanos();
+            auto [batchResults, correctBatch] = runReachabilityQuery(sketch, truth.pathBatch, truth.path);
+            long long batchNanos = monotonicNanos() - start;
+            size_t mismatches = 0;
+            for (size_t i = 0; i < pathResults.size(); i++) {
+                mismatches += batchResults[i] != pathResults[i];
+            }
+            if (mismatches > 0) {
+                cerr << "Batch reachability disagrees with the per-query answers on " << mismatches << " of "
+                     << pathResults.size() << " queries" << endl;
+                exit(EXIT_FAILURE);
             }
+            stats[PATH_BATCH].recordSpan(truth.pathBatch.size(), batchNanos);
+            metrics.precision_reachability_batch = (double)correctBatch / truth.pathBatch.size();
         }
         
-        gettimeofday(&end, NULL);
-        double elapsedTime = (end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec);
-        totalTime += elapsedTime;
+        for (int op = 0; op < OPERATION_COUNT; op++) {
+            if (stats[op].summary().count > 0) {
+                results.push_back({dataset.name, run, stats[op].summary()});
+            }
+            totals[op].merge(stats[op]);
+        }
         
         totalEdgeError += edgeError / EDGE_QUERIES;
         totalVertexError += vertexError / VERTEX_QUERIES;
         totalSubgraphError += subgraphError / subgraphQueries.size();
         correctReachabilityQueries += correctReachability;
         
-        // Measure memory usage
-        double memoryUsage = measureMemoryUsage(matrix);
-        metrics.memory_usage_mb = max(metrics.memory_usage_mb, memoryUsage);
+        // Measure memory usage, keeping the largest run
+        MemoryStats memory = memoryStats(sketch);
+        if (toMB(memory.reservedBytes) > metrics.memory_usage_mb) {
+            metrics.memory_usage_mb = toMB(memory.reservedBytes);
+            metrics.memory_live_mb = toMB(memory.liveBytes);
+            metrics.memory_fragmentation = memory.fragmentation();
+        }
+        metrics.overflow_rate += (double)(sketch.M0.overflow + sketch.M1.overflow) / edges.size() / TOTAL_RUNS;
         
         // Print progress
         if ((run + 1) % 100 == 0) {
@@ -399,12 +714,16 @@ Metrics runExperiment(const DatasetInfo& dataset) {
     metrics.are_edge = totalEdgeError / TOTAL_RUNS;
     metrics.are_vertex = totalVertexError / TOTAL_RUNS;
     metrics.are_subgraph = totalSubgraphError / TOTAL_RUNS;
-    metrics.precision_reachability = (double)correctReachabilityQueries / (TOTAL_RUNS * pathQueries.size());
+    metrics.precision_reachability = (double)correctReachabilityQueries / (TOTAL_RUNS * truth.pathBatch.size());
     
-    // Calculate throughput (Mops = million operations per second)
-    int totalOperations = edges.size() + EDGE_QUERIES + VERTEX_QUERIES + subgraphQueries.size() + pathQueries.size();
-    metrics.throughput_mops = (totalOperations * TOTAL_RUNS) / (totalTime / 1000000.0) / 1000000.0;
-    metrics.avg_query_time_us = totalTime / (TOTAL_RUNS * (EDGE_QUERIES + VERTEX_QUERIES + subgraphQueries.size() + pathQueries.size()));
+    // Throughput and latency of each operation type over all runs (Mops = million operations per second)
+    for (int op = 0; op < OPERATION_COUNT; op++) {
+        metrics.operations.push_back(totals[op].summary());
+        results.push_back({dataset.name, -1, totals[op].summary()});
+    }
+    metrics.switch_insert_mops = metrics.operations[INSERT].mops;
+    metrics.no_switch_insert_mops = metrics.operations[INSERT_NO_SWITCH].mops;
+    metrics.batch_insert_mops = metrics.operations[INSERT_BATCH].mops;
     
     return metrics;
 }
@@ -414,21 +733,48 @@ int main(int argc, char* argv[]) {
     cout << "==================================" << endl;
     
     // Run experiments for all datasets
+    vector<OpResult> results;
     for (const auto& dataset : datasets) {
         cout << "\n=== Experiment with " << dataset.name << " ===" << endl;
-        Metrics metrics = runExperiment(dataset);
+        Metrics metrics = runExperiment(dataset, results);
         
         // Print results
         cout << "\nResults for " << dataset.name << ":" << endl;
         cout << "Average Relative Error (Edge Queries): " << metrics.are_edge << endl;
         cout << "Average Relative Error (Vertex Queries): " << metrics.are_vertex << endl;
         cout << "Average Relative Error (Subgraph Queries): " << metrics.are_subgraph << endl;
-        cout << "Average Precision (Reachability Queries): " << metrics.precision_reachability << endl;
-        cout << "Throughput: " << metrics.throughput_mops << " Mops" << endl;
-        cout << "Memory Usage: " << metrics.memory_usage_mb << " MB" << endl;
-        cout << "Average Query Time: " << metrics.avg_query_time_us << " microseconds" << endl;
+        cout << "Average Precision (Reachability Queries): " << metrics.precision_reachability << " (batch "
+             << metrics.precision_reachability_batch << ")" << endl;
+        cout << "Insert Throughput (switch / no switch): " << metrics.switch_insert_mops << " Mops ("
+             << metrics.switch_reserved_mb << " MB reserved) / " << metrics.no_switch_insert_mops << " Mops ("
+             << metrics.no_switch_reserved_mb << " MB reserved)" << endl;
+        cout << "Insert Throughput (per edge / insertBatch): " << metrics.switch_insert_mops << " Mops ("
+             << metrics.switch_reserved_mb << " MB reserved) / " << metrics.batch_insert_mops << " Mops ("
+             << metrics.batch_reserved_mb << " MB reserved)" << endl;
+        cout << "Memory Usage: " << metrics.memory_usage_mb << " MB reserved, " << metrics.memory_live_mb
+             << " MB live, fragmentation " << metrics.memory_fragmentation << " (budget " << MEMORY_BUDGET_MB << " MB)" << endl;
+        cout << "Exact Baseline: " << metrics.exact_memory_mb << " MB, " << metrics.exact_query_mops << " Mops (queries)" << endl;
+        cout << "Hash Chain Overflow Rate: " << metrics.overflow_rate << endl;
+        for (const auto& op : metrics.operations) {
+            if (op.count == 0) {
+                continue;
+            }
+            cout << op.op << ": " << op.mops << " Mops";
+            if (op.samples > 0) {
+                cout << ", latency p50/p90/p99/max " << op.p50Us << " / " << op.p90Us << " / " << op.p99Us << " / "
+                     << op.maxUs << " us";
+            }
+            cout << endl;
+        }
     }
     
+    string prefix = argc > 1 ? argv[1] : RESULTS_PREFIX;
+    ofstream csv(prefix + ".csv");
+    writeCsv(csv, results);
+    ofstream json(prefix + ".json");
+    writeJson(json, results);
+    cout << "\nWrote " << prefix << ".csv and " << prefix << ".json" << endl;
+    
     // In a real implementation, we would also run experiments with baseline methods
     // and compare the results
     
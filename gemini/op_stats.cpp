@@ -0,0 +1,128 @@
+#include "op_stats.h"
+
+// Bucket 16 * k + s holds [2^k + s * 2^k / 16, 2^k + (s + 1) * 2^k / 16); below 16 ns
+// the buckets are single nanoseconds
+int LatencyHistogram::bucketOf(long long nanos) {
+    if (nanos < SUB_BUCKETS) {
+        return nanos < 0 ? 0 : static_cast<int>(nanos);
+    }
+    int octave = 0;
+    while ((nanos >> (octave + 1)) != 0) {
+        ++octave;
+    }
+    int sub = static_cast<int>((nanos >> (octave - 4)) & (SUB_BUCKETS - 1));
+    return (octave - 3) * SUB_BUCKETS + sub;
+}
+
+double LatencyHistogram::bucketMid(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    int octave = bucket / SUB_BUCKETS + 3;
+    double width = static_cast<double>(1LL << octave) / SUB_BUCKETS;
+    return static_cast<double>(1LL << octave) + (bucket % SUB_BUCKETS + 0.5) * width;
+}
+
+void LatencyHistogram::add(long long nanos) {
+    counts_[bucketOf(nanos)] += 1;
+    total_ += 1;
+    if (nanos > max_) {
+        max_ = nanos;
+    }
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int b = 0; b < BUCKETS; ++b) {
+        counts_[b] += other.counts_[b];
+    }
+    total_ += other.total_;
+    if (other.max_ > max_) {
+        max_ = other.max_;
+    }
+}
+
+double LatencyHistogram::percentile(double p) const {
+    if (total_ == 0) {
+        return 0;
+    }
+    // Nearest rank, never past the largest sample
+    std::size_t rank = static_cast<std::size_t>(p * total_);
+    if (rank >= total_) {
+        rank = total_ - 1;
+    }
+    std::size_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        seen += counts_[b];
+        if (seen > rank) {
+            double mid = bucketMid(b);
+            return mid < max_ ? mid : static_cast<double>(max_);
+        }
+    }
+    return static_cast<double>(max_);
+}
+
+void OpStats::record(long long nanos) {
+    count_ += 1;
+    nanos_ += nanos;
+    latency_.add(nanos);
+}
+
+void OpStats::recordSpan(std::size_t count, long long nanos) {
+    count_ += count;
+    nanos_ += nanos;
+}
+
+void OpStats::merge(const OpStats& other) {
+    count_ += other.count_;
+    nanos_ += other.nanos_;
+    latency_.merge(other.latency_);
+}
+
+OpSummary OpStats::summary() const {
+    OpSummary s;
+    s.op = op_;
+    s.count = count_;
+    s.seconds = nanos_ / 1e9;
+    s.mops = nanos_ > 0 ? count_ * 1e3 / nanos_ : 0;
+    s.samples = latency_.samples();
+    s.p50Us = latency_.percentile(0.5) / 1e3;
+    s.p90Us = latency_.percentile(0.9) / 1e3;
+    s.p99Us = latency_.percentile(0.99) / 1e3;
+    s.maxUs = latency_.max() / 1e3;
+    return s;
+}
+
+void writeCsv(std::ostream& out, const std::vector<OpResult>& results) {
+    out << "dataset,run,op,count,seconds,mops,samples,p50_us,p90_us,p99_us,max_us\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const OpResult& r = results[i];
+        const OpSummary& s = r.summary;
+        out << r.dataset << ',' << r.run << ',' << s.op << ',' << s.count << ',' << s.seconds << ',' << s.mops << ','
+            << s.samples << ',' << s.p50Us << ',' << s.p90Us << ',' << s.p99Us << ',' << s.maxUs << '\n';
+    }
+}
+
+// Dataset and operation names are plain identifiers, but quote the JSON specials anyway
+static std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"' || text[i] == '\\') {
+            quoted += '\\';
+        }
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+void writeJson(std::ostream& out, const std::vector<OpResult>& results) {
+    out << "{\"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const OpResult& r = results[i];
+        const OpSummary& s = r.summary;
+        out << (i == 0 ? "\n" : ",\n") << "  {\"dataset\": " << jsonString(r.dataset) << ", \"run\": " << r.run
+            << ", \"op\": " << jsonString(s.op) << ", \"count\": " << s.count << ", \"seconds\": " << s.seconds
+            << ", \"mops\": " << s.mops << ", \"samples\": " << s.samples << ", \"p50_us\": " << s.p50Us
+            << ", \"p90_us\": " << s.p90Us << ", \"p99_us\": " << s.p99Us << ", \"max_us\": " << s.maxUs << "}";
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,88 @@
+#ifndef OP_STATS_H
+#define OP_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Monotonic clock used for every timing in the experiment, in nanoseconds
+inline long long monotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Log-bucketed latency histogram: 16 buckets per power of two, so a percentile is
+// within about 4% of the exact value. Histograms of the same operation merge by
+// adding bucket counts, which keeps aggregates over many runs small.
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts_(BUCKETS, 0), total_(0), max_(0) {}
+
+    void add(long long nanos);
+    void merge(const LatencyHistogram& other);
+
+    std::size_t samples() const { return total_; }
+    long long max() const { return max_; }
+    // Latency below which a fraction p of the samples fall (0 without samples)
+    double percentile(double p) const;
+
+private:
+    static const int SUB_BUCKETS = 16;
+    static const int BUCKETS = 64 * SUB_BUCKETS;
+
+    static int bucketOf(long long nanos);
+    static double bucketMid(int bucket);
+
+    std::vector<std::size_t> counts_;
+    std::size_t total_;
+    long long max_;
+};
+
+// Throughput and latency of one operation type
+struct OpSummary {
+    std::string op;
+    std::size_t count; // operations
+    double seconds; // time spent in them
+    double mops; // million operations per second
+    std::size_t samples; // operations with a latency sample
+    double p50Us;
+    double p90Us;
+    double p99Us;
+    double maxUs;
+};
+
+// Timings of one operation type. An operation timed on its own (record) adds to the
+// throughput and the latency histogram; operations timed together (recordSpan) add
+// to the throughput only, and sample() adds the latency of one of them.
+class OpStats {
+public:
+    explicit OpStats(const std::string& op) : op_(op), count_(0), nanos_(0) {}
+
+    void record(long long nanos);
+    void recordSpan(std::size_t count, long long nanos);
+    void sample(long long nanos) { latency_.add(nanos); }
+    void merge(const OpStats& other);
+
+    OpSummary summary() const;
+
+private:
+    std::string op_;
+    std::size_t count_;
+    long long nanos_;
+    LatencyHistogram latency_;
+};
+
+// One row of machine-readable results; run is -1 for the aggregate over all runs
+struct OpResult {
+    std::string dataset;
+    int run;
+    OpSummary summary;
+};
+
+// One header line, then a line per result
+void writeCsv(std::ostream& out, const std::vector<OpResult>& results);
+// {"results": [...]} with an object per result
+void writeJson(std::ostream& out, const std::vector<OpResult>& results);
+
+#endif
@@ -0,0 +1,113 @@
+#include "query_executor.h"
+
+QueryExecutor::QueryExecutor(int threads)
+    : task_(nullptr), generation_(0), stopping_(false), remaining_(0), busy_(0) {
+    int count = threads < 1 ? 1 : threads;
+    for (int t = 0; t < count; ++t) {
+        queues_.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+    for (int t = 1; t < count; ++t) {
+        workers_.emplace_back(&QueryExecutor::workerLoop, this, t);
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    {
+        std::lock_guard<std::mutex> guard(jobLock_);
+        stopping_ = true;
+    }
+    jobReady_.notify_all();
+    for (std::size_t t = 0; t < workers_.size(); ++t) {
+        workers_[t].join();
+    }
+}
+
+// Run one range: the back of our own deque first, else the front of another's
+bool QueryExecutor::runRange(int self) {
+    std::pair<std::size_t, std::size_t> range;
+    bool found = false;
+    int count = threads();
+    for (int k = 0; k < count && !found; ++k) {
+        WorkQueue& queue = *queues_[(self + k) % count];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.ranges.empty()) {
+            continue;
+        }
+        if (k == 0) {
+            range = queue.ranges.back();
+            queue.ranges.pop_back();
+        } else {
+            range = queue.ranges.front();
+            queue.ranges.pop_front();
+        }
+        found = true;
+    }
+    if (!found) {
+        return false;
+    }
+
+    for (std::size_t i = range.first; i < range.second; ++i) {
+        (*task_)(i);
+    }
+    remaining_.fetch_sub(range.second - range.first, std::memory_order_acq_rel);
+    return true;
+}
+
+void QueryExecutor::workerLoop(int self) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(jobLock_);
+            jobReady_.wait(guard, [&]() { return stopping_ || generation_ != seen; });
+            if (stopping_) {
+                return;
+            }
+            seen = generation_;
+            busy_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        while (remaining_.load(std::memory_order_acquire) > 0) {
+            if (!runRange(self)) {
+                std::this_thread::yield();
+            }
+        }
+        busy_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void QueryExecutor::parallelFor(std::size_t count, const std::function<void(std::size_t)>& task, std::size_t grain) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+
+    // Publish the task before its ranges, all under the job lock: a worker that pops a
+    // range sees this task, and a late worker from the previous job sees either no
+    // work or all of this job
+    {
+        std::lock_guard<std::mutex> guard(jobLock_);
+        task_ = &task;
+        // Deal the ranges out round-robin so every deque starts with a fair share
+        std::size_t next = 0;
+        for (std::size_t begin = 0; begin < count; begin += grain) {
+            WorkQueue& queue = *queues_[next];
+            std::lock_guard<std::mutex> queueGuard(queue.lock);
+            queue.ranges.push_back(std::make_pair(begin, begin + grain < count ? begin + grain : count));
+            next = (next + 1) % queues_.size();
+        }
+        remaining_.store(count, std::memory_order_release);
+        generation_ += 1;
+    }
+    jobReady_.notify_all();
+
+    while (remaining_.load(std::memory_order_acquire) > 0) {
+        if (!runRange(0)) {
+            std::this_thread::yield();
+        }
+    }
+    // No worker may still hold this task when the next job replaces it
+    while (busy_.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef QUERY_EXECUTOR_H
+#define QUERY_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Work-stealing thread pool for read-only query batches
+// parallelFor splits [0, count) into ranges of `grain` indices and deals them out
+// round-robin to per-thread deques. Each thread takes ranges from the back of its
+// own deque and, once it runs dry, steals from the front of the others'. The
+// calling thread is thread 0, so a pool of one thread runs everything inline.
+class QueryExecutor {
+public:
+    explicit QueryExecutor(int threads);
+    ~QueryExecutor();
+
+    int threads() const { return static_cast<int>(queues_.size()); }
+
+    // Run task(i) for every i in [0, count); returns once all of them have finished
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& task, std::size_t grain = 16);
+
+private:
+    QueryExecutor(const QueryExecutor&);
+    QueryExecutor& operator=(const QueryExecutor&);
+
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<std::pair<std::size_t, std::size_t> > ranges;
+    };
+
+    bool runRange(int self);
+    void workerLoop(int self);
+
+    std::vector<std::unique_ptr<WorkQueue> > queues_;
+    std::vector<std::thread> workers_;
+
+    std::mutex jobLock_;
+    std::condition_variable jobReady_;
+    const std::function<void(std::size_t)>* task_;
+    unsigned long long generation_; // bumped for every parallelFor
+    bool stopping_;
+    std::atomic<std::size_t> remaining_; // indices of the current job not yet run
+    std::atomic<int> busy_; // workers still inside the current job
+};
+
+#endif
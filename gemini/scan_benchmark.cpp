@@ -0,0 +1,227 @@
+#include "GeminiSketch_Algorithm.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+
+// Query benchmark of the bucket layout: the library's totalOutgoingWeight,
+// outgoingEdgeCount and findActiveEdges on the flat WorkingMatrix (after) against
+// the same queries on the nested vector<vector<Bucket>> layout it replaced (before).
+// Both matrices are built from one edge stream, edge by edge, with unrelated
+// allocations of random size made and freed between insertions, so the edge lists
+// of either layout end up spread over the heap as they would in a long-running
+// process. The nested matrix places every <s, d> in the bucket the flat one chose,
+// so both layouts scan the same buckets and must return the same answers.
+
+const int MATRIX_SIZE = 1024;
+const double FILL_RATE = 0.3; // share of buckets given a pair
+const int EDGES_PER_PAIR = 4; // average edges per pair in the stream
+const int HASH_CHAIN_LENGTH = 1;
+const int VERTICES = MATRIX_SIZE * 4;
+const int TIME_SPAN = 1000; // edge times run from 0 to TIME_SPAN
+const int ROW_QUERIES = 20000;
+const int SCAN_REPEATS = 20;
+const int NOISE_MAX_BYTES = 256; // largest unrelated allocation between insertions
+
+// Bucket layout before the flat matrix: metadata and edge list in one object
+struct NestedBucket {
+    pair<int, int> vx;
+    int ec;
+    int CF;
+    vector<Edge> list;
+    int GT;
+    NestedBucket* bqp;
+    NestedBucket() : vx(0, 0), ec(0), CF(0), GT(0), bqp(nullptr) {}
+};
+
+typedef vector<vector<NestedBucket>> NestedMatrix;
+
+// Unrelated heap traffic: allocate a block of random size and, half of the time,
+// free a random earlier one, leaving holes for the next edge list growth to land in
+void churn(vector<vector<char>>& noise, mt19937& gen) {
+    uniform_int_distribution<> sizeDist(16, NOISE_MAX_BYTES);
+    noise.emplace_back(sizeDist(gen));
+    if (gen() % 2 == 0) {
+        size_t victim = gen() % noise.size();
+        swap(noise[victim], noise.back());
+        noise.pop_back();
+    }
+}
+
+// Edge stream over a fixed set of pairs, in time order
+vector<Edge> makeStream(mt19937& gen) {
+    uniform_int_distribution<> vertexDist(0, VERTICES - 1);
+    vector<pair<int, int>> pairs((size_t)(FILL_RATE * MATRIX_SIZE * MATRIX_SIZE));
+    for (auto& sd : pairs) {
+        sd = make_pair(vertexDist(gen), vertexDist(gen));
+    }
+    uniform_int_distribution<size_t> pairDist(0, pairs.size() - 1);
+    size_t count = pairs.size() * EDGES_PER_PAIR;
+    vector<Edge> stream;
+    stream.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        stream.emplace_back(pairs[pairDist(gen)], 1, (int)(i * TIME_SPAN / count));
+    }
+    return stream;
+}
+
+// Insert the stream into the flat matrix with the library's insertion
+void fill(WorkingMatrix& flat, const vector<Edge>& stream, vector<vector<char>>& noise, mt19937& gen) {
+    for (const auto& e : stream) {
+        insertion(flat, e);
+        churn(noise, gen);
+    }
+}
+
+// Replay the stream into the nested matrix, each edge to the bucket the flat matrix
+// stored its pair in (edges the flat matrix dropped are dropped here too)
+void fill(NestedMatrix& nested, const WorkingMatrix& flat, const vector<Edge>& stream, vector<vector<char>>& noise,
+          mt19937& gen) {
+    for (int i = 0; i < flat.size(); i++) {
+        nested.emplace_back(flat.size());
+        churn(noise, gen);
+    }
+    for (const auto& e : stream) {
+        int k = findBucket(flat, e.sd);
+        if (k == -1) {
+            continue;
+        }
+        NestedBucket& bucket = nested[k / flat.size()][k % flat.size()];
+        bucket.vx = e.sd;
+        bucket.ec++;
+        bucket.CF = 1;
+        bucket.GT = e.time;
+        bucket.list.push_back(e);
+        churn(noise, gen);
+    }
+}
+
+// totalOutgoingWeight and outgoingEdgeCount as they were on the nested layout: the
+// rows of v's hash chain, every bucket of v, every edge of its list. The chain is
+// taken from the flat matrix so both layouts visit the same rows.
+int totalOutgoingWeight(const NestedMatrix& nested, const WorkingMatrix& flat, int v, int t_b, int t_e) {
+    int totalWeight = 0;
+    int r = flat.hasher.row(v);
+    for (int offset = 0; offset <= flat.g; offset++) {
+        for (const auto& bucket : nested[flat.probe(r, offset)]) {
+            if (bucket.vx.first == v) {
+                for (const auto& edge : bucket.list) {
+                    if (edge.time >= t_b && edge.time <= t_e) {
+                        totalWeight += edge.weight;
+                    }
+                }
+            }
+        }
+    }
+    return totalWeight;
+}
+
+int outgoingEdgeCount(const NestedMatrix& nested, const WorkingMatrix& flat, int v, int t_b, int t_e) {
+    int count = 0;
+    int r = flat.hasher.row(v);
+    for (int offset = 0; offset <= flat.g; offset++) {
+        for (const auto& bucket : nested[flat.probe(r, offset)]) {
+            if (bucket.vx.first == v) {
+                for (const auto& edge : bucket.list) {
+                    if (edge.time >= t_b && edge.time <= t_e) {
+                        count++;
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// findActiveEdges as it was on the nested layout
+vector<Edge> findActiveEdges(const NestedMatrix& nested, int t_b, int t_e) {
+    vector<Edge> activeEdges;
+    for (const auto& row : nested) {
+        for (const auto& bucket : row) {
+            for (const auto& edge : bucket.list) {
+                if (edge.time >= t_b && edge.time <= t_e) {
+                    activeEdges.push_back(edge);
+                }
+            }
+        }
+    }
+    return activeEdges;
+}
+
+template <typename F>
+double timeMs(int repeats, F f, long long& checksum) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+        checksum += f(r);
+    }
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(end - start).count() / repeats;
+}
+
+// Print one before/after line; false if the two layouts disagreed
+bool report(const string& name, double before, double after, long long beforeSum, long long afterSum) {
+    cout << name << ": nested " << before << " ms, flat " << after << " ms (" << before / after << "x)" << endl;
+    if (beforeSum != afterSum) {
+        cerr << name << " checksum mismatch: " << beforeSum << " != " << afterSum << endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    cout << "Layout query benchmark (" << MATRIX_SIZE << "x" << MATRIX_SIZE << ", fill " << FILL_RATE << ", "
+         << EDGES_PER_PAIR << " edges per pair, interleaved heap)" << endl;
+
+    mt19937 gen(42);
+    vector<Edge> stream = makeStream(gen);
+    vector<vector<char>> noise;
+    WorkingMatrix flat(MATRIX_SIZE, 0, HASH_CHAIN_LENGTH);
+    fill(flat, stream, noise, gen);
+    NestedMatrix nested;
+    fill(nested, flat, stream, noise, gen);
+
+    // Query vertices are sources of stored pairs; windows cover a quarter of the stream
+    uniform_int_distribution<size_t> edgeDist(0, stream.size() - 1);
+    uniform_int_distribution<> timeDist(0, TIME_SPAN - TIME_SPAN / 4);
+    vector<int> vertices(ROW_QUERIES);
+    vector<int> starts(ROW_QUERIES);
+    for (int i = 0; i < ROW_QUERIES; i++) {
+        vertices[i] = stream[edgeDist(gen)].sd.first;
+        starts[i] = timeDist(gen);
+    }
+    const int span = TIME_SPAN / 4;
+
+    bool ok = true;
+    long long before = 0, after = 0;
+    double nestedTime = timeMs(ROW_QUERIES, [&](int i) {
+        return totalOutgoingWeight(nested, flat, vertices[i], starts[i], starts[i] + span);
+    }, before);
+    double flatTime = timeMs(ROW_QUERIES, [&](int i) {
+        return totalOutgoingWeight(flat, vertices[i], starts[i], starts[i] + span);
+    }, after);
+    ok = report("totalOutgoingWeight", nestedTime, flatTime, before, after) && ok;
+
+    before = after = 0;
+    nestedTime = timeMs(ROW_QUERIES, [&](int i) {
+        return outgoingEdgeCount(nested, flat, vertices[i], starts[i], starts[i] + span);
+    }, before);
+    flatTime = timeMs(ROW_QUERIES, [&](int i) {
+        return outgoingEdgeCount(flat, vertices[i], starts[i], starts[i] + span);
+    }, after);
+    ok = report("outgoingEdgeCount", nestedTime, flatTime, before, after) && ok;
+
+    before = after = 0;
+    nestedTime = timeMs(SCAN_REPEATS, [&](int i) {
+        return (long long)findActiveEdges(nested, starts[i], starts[i] + span).size();
+    }, before);
+    flatTime = timeMs(SCAN_REPEATS, [&](int i) {
+        return (long long)findActiveEdges(flat, starts[i], starts[i] + span).size();
+    }, after);
+    ok = report("findActiveEdges", nestedTime, flatTime, before, after) && ok;
+
+    cout << "heap churn blocks alive: " << noise.size() << endl;
+    return ok ? 0 : 1;
+}